@@ -0,0 +1,62 @@
+// batchloader.h
+// * PrivateLibrary
+// * Description:  Load many whole files at once on a bounded pool of I/O threads.
+
+#pragma once
+#ifndef _PRILIB_BATCHLOADER_H_
+#define _PRILIB_BATCHLOADER_H_
+#include "macro.h"
+#include "mappedfile.h"
+#include "stringview.h"
+#include <string>
+#include <vector>
+#include <functional>
+
+PRILIB_BEGIN
+class BatchLoader
+{
+public:
+	enum Mode {
+		Buffer,  // Read into an owned string
+		Map,     // Memory map
+		Auto,    // Map the files of at least 'threshold' bytes, read the others
+	};
+
+	struct Entry {
+		std::string text;
+		MappedFile map;
+		bool mapped = false;
+		int error = 0;  // errno of the failed open/read, 0 if loaded
+
+		bool good() const {
+			return error == 0;
+		}
+		StringViewRange view() const {
+			return mapped ? map.view() : StringViewRange(text);
+		}
+	};
+
+	// Called on the I/O thread that loaded the entry, entries may come in any order.
+	using Callback = std::function<void(size_t index, Entry &entry)>;
+
+public:
+	explicit BatchLoader(size_t threads = 8, Mode mode = Buffer, size_t threshold = 0x100000)
+		: _threads(threads ? threads : 1), _mode(mode), _threshold(threshold) {}
+
+	// Entries in the order of 'filenames'.
+	std::vector<Entry> load(const std::vector<std::string> &filenames) const;
+
+	// Hand each entry to 'callback' as soon as it is loaded, without keeping it.
+	void load(const std::vector<std::string> &filenames, Callback callback) const;
+
+	// Load one file the way the pool does.
+	Entry load(const std::string &filename) const;
+
+private:
+	size_t _threads;
+	Mode _mode;
+	size_t _threshold;
+};
+PRILIB_END
+
+#endif
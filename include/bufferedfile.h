@@ -0,0 +1,175 @@
+// bufferedfile.h
+// * PrivateLibrary
+// * Description:  Large-buffer, lock-free binary I/O over a BinaryFile.
+
+#pragma once
+#ifndef _PRILIB_BUFFEREDFILE_H_
+#define _PRILIB_BUFFEREDFILE_H_
+#include "macro.h"
+#include "file.h"
+#include <string>
+#include <memory>
+#include <cstring>
+
+PRILIB_BEGIN
+// While a writer (or reader) is alive it owns the position of the file :
+// the file must not be used directly until it is destroyed (or 'release'd).
+class BufferedBinaryWriter
+{
+public:
+	struct Span {
+		const void *data;
+		size_t size;
+	};
+
+public:
+	explicit BufferedBinaryWriter(BinaryFile &file, size_t capacity = 0x100000);
+	~BufferedBinaryWriter() {
+		release();
+	}
+
+	BufferedBinaryWriter(const BufferedBinaryWriter&) = delete;
+	BufferedBinaryWriter& operator=(const BufferedBinaryWriter&) = delete;
+
+	bool write(const void *data, size_t size) {
+		if (_size + size <= _capacity) {
+			std::memcpy(_buffer.get() + _size, data, size);
+			_size += size;
+			return _good;
+		}
+		Span span { data, size };
+		return _drain(&span, 1);
+	}
+	template <typename T>
+	bool write(const T *buffer, size_t elcount) {
+		return write(static_cast<const void*>(buffer), sizeof(T) * elcount);
+	}
+	template <typename T>
+	bool write(const T &element) {
+		return write(&element, 1);
+	}
+
+	// Gather all spans, in one system call when they do not fit the buffer.
+	bool writev(const Span *spans, size_t count);
+
+	// Same formats as BinaryFile::read_string and BinaryFile::read_sized_string.
+	bool write_string(const std::string &str, char delimit = '\0') {
+		return write(str.data(), str.size()) && write(delimit);
+	}
+	bool write_sized_string(const std::string &str) {
+		uint32_t length = static_cast<uint32_t>(str.size());
+		return write(length) && write(str.data(), str.size());
+	}
+
+	// Write the buffer out to the file.
+	bool flush() {
+		return _drain(nullptr, 0);
+	}
+
+	// Flush, and give the position back to the file.
+	bool release();
+
+	bool good() const {
+		return _good;
+	}
+
+private:
+	BinaryFile _file;
+	std::unique_ptr<char[]> _buffer;
+	size_t _capacity;
+	size_t _size = 0;
+	bool _good;
+	bool _released = false;
+
+	bool _drain(const Span *spans, size_t count);
+};
+
+class BufferedBinaryReader
+{
+public:
+	struct Span {
+		void *data;
+		size_t size;
+	};
+
+public:
+	explicit BufferedBinaryReader(BinaryFile &file, size_t capacity = 0x100000);
+	~BufferedBinaryReader() {
+		release();
+	}
+
+	BufferedBinaryReader(const BufferedBinaryReader&) = delete;
+	BufferedBinaryReader& operator=(const BufferedBinaryReader&) = delete;
+
+	// Return the count of bytes read.
+	size_t read(void *data, size_t size) {
+		if (size <= available()) {
+			std::memcpy(data, window(), size);
+			_begin += size;
+			return size;
+		}
+		Span span { data, size };
+		return readv(&span, 1);
+	}
+	template <typename T>
+	bool read(T *buffer, size_t elcount) {
+		return read(static_cast<void*>(buffer), sizeof(T) * elcount) == sizeof(T) * elcount;
+	}
+	template <typename T>
+	bool read(T &element) {
+		return read(&element, 1);
+	}
+
+	// Scatter into all spans, large spans are read in the same system call as the next buffer.
+	size_t readv(const Span *spans, size_t count);
+
+	// Same as BinaryFile::read_string, scanning the buffer with memchr.
+	bool read_string(std::string &result, char delimit = '\0');
+
+	// Same as BinaryFile::read_sized_string.
+	bool read_sized_string(std::string &result) {
+		uint32_t length;
+		if (!read(length))
+			return false;
+		if (length <= available()) {
+			result.assign(window(), length);
+			consume(length);
+			return true;
+		}
+		result.resize(length);
+		return length == 0 || read(static_cast<void*>(&result[0]), length) == length;
+	}
+
+	bool eof() const {
+		return _eof && available() == 0;
+	}
+
+	// The buffered bytes, for parsing in place.
+	const char* window() const {
+		return _buffer.get() + _begin;
+	}
+	size_t available() const {
+		return _end - _begin;
+	}
+	void consume(size_t size) {
+		_begin += size;
+	}
+	// Move the buffered bytes to the front and read more after them.
+	// Return false if nothing more could be read.
+	bool fill();
+
+	// Give the unread position back to the file.
+	void release();
+
+private:
+	BinaryFile _file;
+	std::unique_ptr<char[]> _buffer;
+	size_t _capacity;
+	size_t _begin = 0;
+	size_t _end = 0;
+	bool _eof = false;
+	bool _released = false;
+};
+PRILIB_END
+
+#endif
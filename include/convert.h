@@ -6,9 +6,16 @@
 #define _PRILIB_CONVERT_H_
 #include "macro.h"
 #include "charptr.h"
+#include "stringview.h"
 #include <string>
+#include <vector>
 #include <functional>
+#include <algorithm>
+#include <iterator>
 #include <limits>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
 
 PRILIB_BEGIN
 namespace Convert
@@ -60,31 +67,232 @@ namespace Convert
 		snprintf(buffer, size, "0x%p", p);
 		return buffer.str();
 	}
-	template <char B = '\0', char E = '\0', char D = '\0', typename Iter, typename Func>
-	std::string to_string(Iter begin, Iter end, Func func) {
-		std::string str;
-		if (B != '\0')
-			str.push_back(B);
-		if (begin != end) {
-			str.append(func(*begin++));
-			while (begin != end) {
-				if (D != '\0')
-					str.push_back(D);
-				if (D != '\n')
-					str.append(" ");
-				str.append(func(*begin++));
+	// To Chars
+	//   Write the text of a number to [first, last).
+	//   Return the end of the text, nullptr if it does not fit : 'chars_size' bytes always fit.
+	//   Floating values are the shortest text reading back to the same value (Grisu3),
+	//   laid out as in ECMAScript : 1.5 100 1e+21 1e-7.
+	constexpr size_t chars_size = 32;
+
+	char* to_chars_u32(char *first, char *last, uint32_t value);
+	char* to_chars_u64(char *first, char *last, uint64_t value);
+	template <typename T>
+	typename std::enable_if<std::is_integral<T>::value, char*>::type to_chars(char *first, char *last, T value) {
+		using U = typename std::conditional<sizeof(T) <= 4, uint32_t, uint64_t>::type;
+		U u = static_cast<U>(value);
+		if (std::is_signed<T>::value && value < T(0)) {
+			if (first == last)
+				return nullptr;
+			*first++ = '-';
+			u = U(0) - u;
+		}
+		return sizeof(T) <= 4 ? to_chars_u32(first, last, static_cast<uint32_t>(u)) : to_chars_u64(first, last, u);
+	}
+	char* to_chars(char *first, char *last, float value);
+	char* to_chars(char *first, char *last, double value);
+	char* to_chars(char *first, char *last, long double value);
+
+	//   Numbers (bool and char have their own)
+	template <typename T>
+	struct IsNumber : std::integral_constant<bool,
+		std::is_arithmetic<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value> {};
+
+	template <typename T>
+	inline typename std::enable_if<IsNumber<T>::value, std::string>::type to_string(T value)
+	{
+		char buffer[chars_size];
+		return std::string(buffer, to_chars(buffer, buffer + chars_size, value));
+	}
+
+	// Join
+	//   Elements between 'delimiter's, after 'prefix' and before 'suffix', written into one string.
+	//   A forward range is counted first, then numbers take their widest text and strings their
+	//   length from one allocation, and are formatted in place; the string is cut to size at the end.
+	//   Other elements go through to_string, and 'func' results are appended with an estimated reserve.
+	template <typename T>
+	struct JoinWidth : std::integral_constant<size_t,
+		std::is_integral<T>::value ? std::numeric_limits<T>::digits10 + 2 : chars_size> {};
+
+	template <typename T>
+	struct IsText : std::integral_constant<bool,
+		std::is_same<T, std::string>::value || std::is_same<T, StringViewRange>::value ||
+		std::is_same<T, const char*>::value || std::is_same<T, char*>::value> {};
+
+	inline StringViewRange join_text(const std::string &str) { return StringViewRange(str); }
+	inline StringViewRange join_text(const StringViewRange &str) { return str; }
+	inline StringViewRange join_text(const char *s) { return StringViewRange(s); }
+
+	class Joiner
+	{
+	public:
+		Joiner(const std::string &delimiter, const std::string &prefix, const std::string &suffix)
+			: _delimiter(delimiter), _prefix(prefix), _suffix(suffix) {}
+
+		// Numbers
+		template <typename Iter>
+		std::string join(Iter begin, Iter end, std::true_type, std::false_type) const {
+			using T = typename std::decay<decltype(*begin)>::type;
+			const size_t width = JoinWidth<T>::value;
+			std::string result;
+			char *p = _start(result, begin, end, [=](const T &) { return width; });
+			for (bool first = true; begin != end; ++begin, first = false) {
+				p = _room(result, p, width, first);
+				p = to_chars(p, p + width, *begin);
+			}
+			_finish(result, p);
+			return result;
+		}
+		// Strings
+		template <typename Iter>
+		std::string join(Iter begin, Iter end, std::false_type, std::true_type) const {
+			std::string result;
+			char *p = _start(result, begin, end, [](const auto &e) { return join_text(e).size(); });
+			for (bool first = true; begin != end; ++begin, first = false) {
+				StringViewRange text = join_text(*begin);
+				p = _room(result, p, text.size(), first);
+				std::memcpy(p, text.begin(), text.size());
+				p += text.size();
 			}
+			_finish(result, p);
+			return result;
 		}
-		if (E != '\0')
-			str.push_back(E);
-		return str;
+		// Others
+		template <typename Iter>
+		std::string join(Iter begin, Iter end, std::false_type, std::false_type) const {
+			using Convert::to_string;
+			return join(begin, end, [](const auto &e) { return to_string(e); });
+		}
+		template <typename Iter, typename Func>
+		std::string join(Iter begin, Iter end, Func func) const {
+			std::string result(_prefix);
+			for (bool first = true; begin != end; ++begin) {
+				if (first) {
+					const auto &text = func(*begin);
+					result.reserve(_prefix.size() + _suffix.size() + (_count(begin, end) * (_length(text) + _delimiter.size())));
+					_append(result, text);
+					first = false;
+					continue;
+				}
+				result.append(_delimiter);
+				_append(result, func(*begin));
+			}
+			result.append(_suffix);
+			return result;
+		}
+
+	private:
+		const std::string &_delimiter;
+		const std::string &_prefix;
+		const std::string &_suffix;
+
+		// Length of a 'func' result, as appended : 0 (no estimate) for what 'append' converts.
+		static size_t _length(const std::string &text) {
+			return text.size();
+		}
+		static size_t _length(const char *text) {
+			return std::strlen(text);
+		}
+		static size_t _length(const StringViewRange &text) {
+			return text.size();
+		}
+		template <typename T>
+		static size_t _length(const T &) {
+			return 0;
+		}
+
+		static void _append(std::string &result, const StringViewRange &text) {
+			result.append(text.begin(), text.size());
+		}
+		template <typename T>
+		static void _append(std::string &result, const T &text) {
+			result.append(text);
+		}
+
+		template <typename Iter>
+		static size_t _count(Iter begin, Iter end, std::forward_iterator_tag) {
+			return static_cast<size_t>(std::distance(begin, end));
+		}
+		template <typename Iter>
+		static size_t _count(Iter, Iter, std::input_iterator_tag) {
+			return 1;
+		}
+		template <typename Iter>
+		static size_t _count(Iter begin, Iter end) {
+			return _count(begin, end, typename std::iterator_traits<Iter>::iterator_category());
+		}
+
+		// Size the string for the whole range, or for the prefix alone when it can only be read once.
+		template <typename Iter, typename Width>
+		char* _start(std::string &result, Iter begin, Iter end, Width width) const {
+			size_t size = _prefix.size() + _suffix.size();
+			if (std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<Iter>::iterator_category>::value) {
+				size_t count = 0;
+				for (Iter it = begin; it != end; ++it, ++count)
+					size += width(*it);
+				if (count != 0)
+					size += (count - 1) * _delimiter.size();
+			}
+			result.resize(size);
+			std::memcpy(&result[0], _prefix.data(), _prefix.size());
+			return &result[0] + _prefix.size();
+		}
+		// Write the delimiter before the next element, growing geometrically when out of room.
+		char* _room(std::string &result, char *p, size_t width, bool first) const {
+			size_t size = p - &result[0];
+			size_t need = size + (first ? 0 : _delimiter.size()) + width + _suffix.size();
+			if (need > result.size()) {
+				result.resize(std::max(need, result.size() * 2));
+				p = &result[0] + size;
+			}
+			if (!first) {
+				std::memcpy(p, _delimiter.data(), _delimiter.size());
+				p += _delimiter.size();
+			}
+			return p;
+		}
+		void _finish(std::string &result, char *p) const {
+			std::memcpy(p, _suffix.data(), _suffix.size());
+			result.resize(p - &result[0] + _suffix.size());
+		}
+	};
+
+	template <typename Iter>
+	inline std::string join(Iter begin, Iter end, const std::string &delimiter = ", ", const std::string &prefix = std::string(), const std::string &suffix = std::string()) {
+		using T = typename std::decay<decltype(*begin)>::type;
+		return Joiner(delimiter, prefix, suffix).join(begin, end,
+			std::integral_constant<bool, IsNumber<T>::value>(), std::integral_constant<bool, IsText<T>::value>());
+	}
+	template <typename Iter, typename Func>
+	inline std::string join_with(Iter begin, Iter end, Func func, const std::string &delimiter = ", ", const std::string &prefix = std::string(), const std::string &suffix = std::string()) {
+		return Joiner(delimiter, prefix, suffix).join(begin, end, func);
+	}
+
+	//   Range as B e0D e1D e2E, without the space when D is '\n'.
+	template <char B, char E, char D>
+	struct JoinFormat
+	{
+		std::string prefix, suffix, delimiter;
+		JoinFormat() {
+			if (B != '\0')
+				prefix.push_back(B);
+			if (E != '\0')
+				suffix.push_back(E);
+			if (D != '\0')
+				delimiter.push_back(D);
+			if (D != '\n')
+				delimiter.push_back(' ');
+		}
+	};
+
+	template <char B = '\0', char E = '\0', char D = '\0', typename Iter, typename Func>
+	inline std::string to_string(Iter begin, Iter end, Func func) {
+		JoinFormat<B, E, D> format;
+		return join_with(begin, end, func, format.delimiter, format.prefix, format.suffix);
 	}
 	template <char B = '\0', char E = '\0', char D = '\0', typename Iter>
 	inline std::string to_string(Iter begin, Iter end) {
-		using std::to_string;
-		using Convert::to_string;
-
-		return to_string<B, E, D>(begin, end, [](const auto &e) { return to_string(e); });
+		JoinFormat<B, E, D> format;
+		return join(begin, end, format.delimiter, format.prefix, format.suffix);
 	}
 }
 
@@ -113,11 +321,91 @@ namespace Convert
 	inline std::string to_hex(int64_t i) { return to_hex(i, "%016llx"); }
 	inline std::string to_hex(uint64_t i) { return to_hex(i, "%016llx"); }
 
+	// Hex of a byte array, most significant nibble first, uppercase, a separator between bytes ('\0' for none).
+	inline size_t hex_size(size_t size, char separator = ' ') {
+		return size == 0 ? 0 : (separator != '\0' ? size * 3 - 1 : size * 2);
+	}
+	// Write 'hex_size(size, separator)' chars to 'dst', without '\0'. Return the end of the text.
+	char* hex_encode(const void *src, size_t size, char *dst, char separator = ' ');
+	// Bytes of pairs of hex digits (either case) in text order, 'length' even.
+	// Return false at an invalid digit, the bytes before it are written.
+	bool hex_decode(const char *src, size_t length, void *dst);
+
 	std::string to_hex(const void *src, size_t size);
 }
 
 namespace Convert
 {
+	// From Chars
+	//   Parse all of [first, last) : an optional sign, then digits of 'base' (2 to 36) in either case.
+	//   No whitespace or prefix is skipped. Return false on any other char or on overflow, 'result' is left as is.
+	//   Decimal digits are taken 8 at a time (SWAR).
+	bool from_chars_u64(const char *first, const char *last, uint64_t max, uint64_t &result, int base = 10);
+	template <typename T>
+	typename std::enable_if<std::is_integral<T>::value, bool>::type from_chars(const char *first, const char *last, T &result, int base = 10) {
+		bool negative = false;
+		if (first != last && (*first == '-' || *first == '+')) {
+			negative = (*first++ == '-');
+			if (negative && !std::is_signed<T>::value)
+				return false;
+		}
+		uint64_t max = static_cast<uint64_t>(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+		uint64_t value;
+		if (!from_chars_u64(first, last, max, value, base))
+			return false;
+		result = static_cast<T>(negative ? 0 - value : value);
+		return true;
+	}
+	template <typename T>
+	inline typename std::enable_if<std::is_integral<T>::value, bool>::type from_chars(const StringViewRange &str, T &result, int base = 10) {
+		return from_chars(str.begin(), str.end(), result, base);
+	}
+
+	//   [+-] digits [. digits] [eE [+-] digits], "inf", "infinity" or "nan", the whole range, whatever the locale.
+	//   The closest value (Eisel-Lemire, falling back to strtod on rare ties), out of range becomes inf or 0.
+	bool from_chars(const char *first, const char *last, double &result);
+	bool from_chars(const char *first, const char *last, float &result);
+	inline bool from_chars(const StringViewRange &str, double &result) {
+		return from_chars(str.begin(), str.end(), result);
+	}
+	inline bool from_chars(const StringViewRange &str, float &result) {
+		return from_chars(str.begin(), str.end(), result);
+	}
+	//   A column at once : dst[i] from src[i] (base 10), a field failing to parse gets 'invalid'.
+	//   'invalid' defaults to NaN for float and double, integer columns must give it.
+	//   With 'errors', errors[i] is 1 for a failed field and 0 otherwise. Return the count of failures.
+	//   Integer fields of 9 to 16 digits are checked and parsed 16 bytes at once (SSE2), others as from_chars.
+	//   Columns of 'column_grain' fields or more are split over up to 'threads' threads.
+	//   For signed and unsigned char, short, int, long, long long, and float and double.
+	constexpr size_t column_grain = 0x4000;
+
+	template <typename T>
+	struct IsColumn : std::integral_constant<bool,
+		std::is_same<T, signed char>::value || std::is_same<T, unsigned char>::value ||
+		std::is_same<T, short>::value || std::is_same<T, unsigned short>::value ||
+		std::is_same<T, int>::value || std::is_same<T, unsigned>::value ||
+		std::is_same<T, long>::value || std::is_same<T, unsigned long>::value ||
+		std::is_same<T, long long>::value || std::is_same<T, unsigned long long>::value ||
+		std::is_same<T, float>::value || std::is_same<T, double>::value> {};
+
+	template <typename T>
+	size_t from_chars_column(const StringViewRange *src, size_t count, T *dst, T invalid, uint8_t *errors, size_t threads);
+
+	template <typename T>
+	constexpr T column_invalid() {
+		static_assert(std::is_floating_point<T>::value, "from_chars_n : an integer column needs an explicit 'invalid'");
+		return std::numeric_limits<T>::quiet_NaN();
+	}
+
+	template <typename T>
+	inline size_t from_chars_n(const StringViewRange *src, size_t count, T *dst, T invalid = column_invalid<T>(), uint8_t *errors = nullptr, size_t threads = 1) {
+		static_assert(IsColumn<T>::value, "from_chars_n : signed or unsigned char, short, int, long, long long, float or double");
+		return from_chars_column(src, count, dst, invalid, errors, threads);
+	}
+
+	// to_ll and to_ull : as strtoll, whole strings only.
+	//   Leading whitespace is skipped, base 0 detects the base from the prefix.
+	//   Plain digits take from_chars, anything else strtoll.
 	bool to_ll(const std::string &str, long long &result, int base = 10);
 	bool to_ull(const std::string &str, unsigned long long &result, int base = 10);
 	bool to_base16(const std::string &str, void *dst, size_t size = 0, size_t msize = 0); // lsb : msize = 0, msb : msize > 0
@@ -135,6 +423,7 @@ namespace Convert
 		return s;
 	}
 
+	// As to_ll and to_ull : leading whitespace, and prefixes with base 0, are accepted.
 	template <typename T>
 	bool to_integer(const std::string &str, T &result, int base = 10) {
 		T min = std::numeric_limits<T>::min();
@@ -157,6 +446,11 @@ namespace Convert
 		}
 		return true;
 	}
+	// Strict, as from_chars : no whitespace or prefix, base 2 to 36.
+	template <typename T>
+	bool to_integer(const StringViewRange &str, T &result, int base = 10) {
+		return from_chars(str.begin(), str.end(), result, base);
+	}
 
 	template <typename T, typename ST>
 	T to_integer(const ST &src, std::function<void()> errfunc, int base = 10) {
@@ -184,6 +478,112 @@ namespace Convert
 	//  lastremain : false
 	//   a,b, -> a b
 	void split(const std::string &token, const std::string &delimit, std::function<void(const char*)> yield, bool remain = false, bool lastremain = false);
+
+	// A set of delimiter chars, as a bitmap.
+	class Delimiter
+	{
+	public:
+		Delimiter(char c) {
+			_add(c);
+		}
+		Delimiter(const char *set) {
+			for (; *set; ++set)
+				_add(*set);
+		}
+		Delimiter(const std::string &set) {
+			for (char c : set)
+				_add(c);
+		}
+
+		bool contains(char c) const {
+			unsigned char u = static_cast<unsigned char>(c);
+			return (_bits[u >> 6] >> (u & 63)) & 1;
+		}
+
+		// The first delimiter in [p, last), or 'last'.
+		// One char : memchr, up to 8 : SSE2 compares, else the bitmap.
+		const char* find(const char *p, const char *last) const {
+			if (_count == 1) {
+				auto q = static_cast<const char*>(std::memchr(p, _chars[0], last - p));
+				return q ? q : last;
+			}
+			return _find(p, last);
+		}
+		// The first char in [p, last) not a delimiter, or 'last'.
+		const char* skip(const char *p, const char *last) const {
+			while (p != last && contains(*p))
+				++p;
+			return p;
+		}
+
+	private:
+		uint64_t _bits[4] = { 0, 0, 0, 0 };
+		char _chars[8];
+		size_t _count = 0;  // distinct chars
+
+		void _add(char c) {
+			if (contains(c))
+				return;
+			unsigned char u = static_cast<unsigned char>(c);
+			_bits[u >> 6] |= static_cast<uint64_t>(1) << (u & 63);
+			if (_count < sizeof(_chars))
+				_chars[_count] = c;
+			++_count;
+		}
+		const char* _find(const char *p, const char *last) const;
+	};
+
+	// As split above, yielding StringViewRange pieces of [first, last) without copying.
+	template <typename Func>
+	void split(const char *first, const char *last, const Delimiter &delimit, Func yield, bool remain = false, bool lastremain = false) {
+		if (remain) {
+			while (true) {
+				const char *p = delimit.find(first, last);
+				if (p == last)
+					break;
+				yield(StringViewRange(first, p - first));
+				first = p + 1;
+			}
+			if (first != last || lastremain)
+				yield(StringViewRange(first, last - first));
+		}
+		else {
+			while ((first = delimit.skip(first, last)) != last) {
+				const char *p = delimit.find(first, last);
+				yield(StringViewRange(first, p - first));
+				if (p == last)
+					break;
+				first = p + 1;
+			}
+		}
+	}
+	template <typename Func>
+	inline void split(const StringViewRange &token, const Delimiter &delimit, Func yield, bool remain = false, bool lastremain = false) {
+		split(token.begin(), token.end(), delimit, yield, remain, lastremain);
+	}
+
+	// A column held in one buffer, as fields between delimiters (an empty last field is dropped) :
+	// the fields are appended to 'dst', and their flags to 'errors', as from_chars_n above.
+	template <typename T>
+	size_t from_chars_n(const char *first, const char *last, const Delimiter &delimit, std::vector<T> &dst,
+		T invalid = column_invalid<T>(), std::vector<uint8_t> *errors = nullptr, size_t threads = 1) {
+		std::vector<StringViewRange> fields;
+		split(first, last, delimit, [&](const StringViewRange &field) { fields.push_back(field); }, true, false);
+		const size_t offset = dst.size();
+		dst.resize(offset + fields.size());
+		uint8_t *flags = nullptr;
+		if (errors != nullptr) {
+			const size_t eoffset = errors->size();
+			errors->resize(eoffset + fields.size());
+			flags = errors->data() + eoffset;
+		}
+		return fields.empty() ? 0 : from_chars_n(fields.data(), fields.size(), dst.data() + offset, invalid, flags, threads);
+	}
+	template <typename T>
+	inline size_t from_chars_n(const StringViewRange &str, const Delimiter &delimit, std::vector<T> &dst,
+		T invalid = column_invalid<T>(), std::vector<uint8_t> *errors = nullptr, size_t threads = 1) {
+		return from_chars_n(str.begin(), str.end(), delimit, dst, invalid, errors, threads);
+	}
 }
 PRILIB_END
 
@@ -10,7 +10,17 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <utility>
+#include <cstring>
 #include "file.h"
+#include "stringview.h"
+
+#if PRILIB_OS_IS_UNIX(PRILIB_OS)
+#	include <sys/stat.h>
+#endif
 
 PRILIB_BEGIN
 class CSVLoader
@@ -19,6 +29,9 @@ public:
 	struct Size {
 		size_t row, column;
 	};
+	// fields[i] is the column (i + 1) of the source line.
+	using Fields = std::vector<StringViewRange>;
+	using Predicate = std::function<bool(const Fields&)>;
 public:
 	explicit CSVLoader(TextFile &file) {
 		_load(file);
@@ -27,85 +40,446 @@ public:
 		_load(file);
 	}
 
-	std::string& at(size_t row, size_t column) {
-		return const_cast<std::string&>(const_cast<const CSVLoader*>(this)->at(row, column));
+	// columns : 1, 2, ... (same as 'at')
+	// Only the selected columns are stored, in the given order.
+	// Lines rejected by 'pred' are dropped before any field is copied.
+	explicit CSVLoader(TextFile &file, const std::vector<size_t> &columns, Predicate pred = nullptr)
+		: _columns(columns), _predicate(pred) {
+		assert(std::find(_columns.begin(), _columns.end(), 0) == _columns.end());
+		_load(file);
+	}
+	explicit CSVLoader(TextFile &&file, const std::vector<size_t> &columns, Predicate pred = nullptr)
+		: CSVLoader(file, columns, pred) {}
+
+	explicit CSVLoader(TextFile &file, Predicate pred)
+		: _predicate(pred) {
+		_load(file);
+	}
+	explicit CSVLoader(TextFile &&file, Predicate pred)
+		: CSVLoader(file, pred) {}
+
+	// Loaded from a file name, the loader can follow the file with 'refresh'.
+	explicit CSVLoader(const std::string &filename, const std::vector<size_t> &columns = {}, Predicate pred = nullptr)
+		: _columns(columns), _predicate(pred), _filename(filename) {
+		assert(std::find(_columns.begin(), _columns.end(), 0) == _columns.end());
+		TextFile file(filename);
+		_load(file);
+	}
+
+	// A copy shares the table until either side writes,
+	// but not once the non-const 'begin' or 'end' handed out writable iterators to it.
+	CSVLoader(const CSVLoader &other)
+		: _data(other._unshareable ? std::make_shared<Table>(*other._data) : other._data),
+		_edits(other._edits), _columns(other._columns), _predicate(other._predicate),
+		_filename(other._filename), _fileid(other._fileid), _offset(other._offset), _end(other._end),
+		_partial(other._partial), _recsize(other._recsize) {}
+	CSVLoader(CSVLoader&&) = default;
+	CSVLoader& operator=(const CSVLoader &other) {
+		if (this != &other)
+			*this = CSVLoader(other);
+		return *this;
+	}
+	CSVLoader& operator=(CSVLoader&&) = default;
+
+	// Append the rows of the lines appended to the file since the last load.
+	// A truncated or replaced (rotated) file is loaded again from the beginning,
+	// dropping all rows and edits.
+	// Return the count of rows added.
+	size_t refresh() {
+		if (_filename.empty())
+			return 0;
+		TextFile file(_filename);
+		if (file.bad())
+			return 0;
+		if (_identity(file) != _fileid || file.size() < _end) {
+			_data = std::make_shared<Table>();
+			_unshareable = false;
+			_edits.clear();
+			_recsize = 0;
+			_offset = 0;
+			_end = 0;
+			_partial = false;
+			_load(file);
+			return row();
+		}
+		if (file.size() == _end)
+			return 0;
+		_unshare();
+		if (_partial) {
+			// The last row came from an unterminated line, read it again.
+			_data->pop_back();
+			_edits.erase(_edits.lower_bound(Post(row(), 0)), _edits.end());
+			_partial = false;
+		}
+		const size_t count = row();
+		file.seek(static_cast<File::OffsetType>(_offset));
+		_parse(file);
+		return row() - count;
+	}
+
+	// words : A, B, AA, ... -> 1, 2, 27, ...
+	static std::vector<size_t> parse_columns(const std::vector<std::string> &words) {
+		std::vector<size_t> columns;
+		columns.reserve(words.size());
+		for (auto &word : words) {
+			std::string wcolumn;
+			for (char c : word) {
+				assert(std::isalpha(c));
+				wcolumn.push_back(std::toupper(c));
+			}
+			columns.push_back(_parse_column(wcolumn));
+		}
+		return columns;
+	}
+
+	// A cell from the non-const 'at' : reads as the const 'at', assignments go to 'set'.
+	class Cell
+	{
+	public:
+		Cell(CSVLoader &loader, size_t row, size_t column)
+			: _loader(loader), _row(row), _column(column) {}
+
+		Cell& operator=(const std::string &value) {
+			_loader.set(_row, _column, value);
+			return *this;
+		}
+		Cell& operator=(const Cell &other) {
+			return *this = other.str();
+		}
+		Cell& operator+=(const std::string &value) {
+			return *this = str() + value;
+		}
+
+		const std::string& str() const {
+			return static_cast<const CSVLoader&>(_loader).at(_row, _column);
+		}
+		operator const std::string&() const {
+			return str();
+		}
+		const char* c_str() const {
+			return str().c_str();
+		}
+		size_t size() const {
+			return str().size();
+		}
+		bool empty() const {
+			return str().empty();
+		}
+
+		bool operator==(const std::string &value) const {
+			return str() == value;
+		}
+		bool operator!=(const std::string &value) const {
+			return str() != value;
+		}
+
+	private:
+		CSVLoader &_loader;
+		size_t _row, _column;
+	};
+
+	// Writes through 'set' (or a Cell) go to a sparse edit overlay,
+	// the loaded table itself is shared between copies and never modified in place.
+	// 'at' reads through the overlay; its references are invalidated by 'set' and 'commit'.
+	Cell at(size_t row, size_t column) {
+		_data->at(row - 1).at(column - 1);  // range check, as the const 'at'
+		return Cell(*this, row, column);
 	}
 	const std::string& at(size_t row, size_t column) const {
-		return _data.at(row - 1).at(column - 1);
+		if (!_edits.empty()) {
+			auto iter = _edits.find(std::make_pair(row - 1, column - 1));
+			if (iter != _edits.end())
+				return iter->second;
+		}
+		return _data->at(row - 1).at(column - 1);
 	}
 
 	// word : A1, AA11, ...
-	std::string& at(const std::string &word) {
-		return const_cast<std::string&>(const_cast<const CSVLoader*>(this)->at(word));
+	Cell at(const std::string &word) {
+		auto post = _parse_post(word);
+		return at(post.row, post.column);
 	}
 	const std::string& at(const std::string &word) const {
 		auto post = _parse_post(word);
 		return at(post.row, post.column);
 	}
 
+	void set(size_t row, size_t column, const std::string &value) {
+		_data->at(row - 1).at(column - 1);  // range check, as 'at'
+		_edits[std::make_pair(row - 1, column - 1)] = value;
+	}
+	void set(const std::string &word, const std::string &value) {
+		auto post = _parse_post(word);
+		set(post.row, post.column, value);
+	}
+
+	// The count of edited cells not yet merged into the table.
+	size_t edits() const {
+		return _edits.size();
+	}
+
+	// Merge the edit overlay into the table, copying the table first if it is shared.
+	// Called by the non-const 'begin', 'end' and 'data'.
+	void commit() {
+		if (_edits.empty())
+			return;
+		_unshare();
+		for (auto &edit : _edits)
+			(*_data)[edit.first.first][edit.first.second] = std::move(edit.second);
+		_edits.clear();
+	}
+
+	// A row read through the edit overlay, from the const 'begin' and 'end'
+	// (which gave plain table iterators before the overlay).
+	// Cells are indexed from 0, as the rows of the table.
+	class const_iterator;
+	class RowView
+	{
+	public:
+		class iterator
+		{
+		public:
+			iterator(const RowView &view, size_t column)
+				: _view(view), _column(column) {}
+			const std::string& operator*() const {
+				return _view[_column];
+			}
+			iterator& operator++() {
+				++_column;
+				return *this;
+			}
+			bool operator==(const iterator &other) const {
+				return _column == other._column;
+			}
+			bool operator!=(const iterator &other) const {
+				return _column != other._column;
+			}
+		private:
+			const RowView &_view;
+			size_t _column;
+		};
+
+	public:
+		RowView(const CSVLoader &loader, size_t row)
+			: _loader(loader), _row(row) {}
+
+		size_t size() const {
+			return (*_loader._data)[_row].size();
+		}
+		const std::string& operator[](size_t column) const {
+			return _loader.at(_row + 1, column + 1);
+		}
+		const std::string& at(size_t column) const {
+			return _loader.at(_row + 1, column + 1);
+		}
+		iterator begin() const {
+			return iterator(*this, 0);
+		}
+		iterator end() const {
+			return iterator(*this, size());
+		}
+
+	private:
+		friend class const_iterator;
+		const CSVLoader &_loader;
+		size_t _row;
+	};
+
+	class const_iterator
+	{
+	public:
+		const_iterator(const CSVLoader &loader, size_t row)
+			: _view(loader, row) {}
+		const RowView& operator*() const {
+			return _view;
+		}
+		const RowView* operator->() const {
+			return &_view;
+		}
+		const_iterator& operator++() {
+			++_view._row;
+			return *this;
+		}
+		bool operator==(const const_iterator &other) const {
+			return _view._row == other._view._row;
+		}
+		bool operator!=(const const_iterator &other) const {
+			return _view._row != other._view._row;
+		}
+	private:
+		RowView _view;
+	};
+
 	Size size() const {
 		return Size { row(), column() };
 	}
 
 	size_t row() const {
-		return _data.size();
+		return _data->size();
 	}
 	size_t column() const {
-		return _data.empty() ? 0 : _data.at(0).size();
+		return _data->empty() ? 0 : _data->at(0).size();
 	}
 
 	auto data() {
-		return _data;
+		commit();
+		return *_data;
 	}
+	// A merged copy, leaving the overlay as is.
 	auto data() const {
-		return _data;
+		Table table = *_data;
+		for (auto &edit : _edits)
+			table[edit.first.first][edit.first.second] = edit.second;
+		return table;
 	}
 
 	auto begin() {
-		return _data.begin();
+		_detach();
+		return _data->begin();
 	}
-	auto begin() const {
-		return _data.begin();
+	const_iterator begin() const {
+		return const_iterator(*this, 0);
 	}
 
 	auto end() {
-		return _data.end();
+		_detach();
+		return _data->end();
 	}
-	auto end() const {
-		return _data.end();
+	const_iterator end() const {
+		return const_iterator(*this, row());
 	}
 
+	// Streams the table and the edit overlay together, without merging them.
 	void save(TextFile &output) const {
-		for (auto &dat : _data) {
+		auto edit = _edits.begin();
+		for (size_t r = 0; r != _data->size(); ++r) {
+			auto &dat = (*_data)[r];
 			for (size_t i = 0; i != dat.size(); ++i) {
 				if (i != 0)
 					output.write(",");
-				output.write(dat[i]);
+				if (edit != _edits.end() && edit->first.first == r && edit->first.second == i) {
+					output.write(edit->second);
+					++edit;
+				}
+				else {
+					output.write(dat[i]);
+				}
 			}
 			output.write("\n");
 		}
 	}
 
 private:
-	std::vector<std::vector<std::string>> _data;
+	using Table = std::vector<std::vector<std::string>>;
+	using Post = std::pair<size_t, size_t>; // (row - 1, column - 1)
+
+	std::shared_ptr<Table> _data = std::make_shared<Table>();
+	bool _unshareable = false;  // writable iterators to '_data' were handed out
+	std::map<Post, std::string> _edits;
+	std::vector<size_t> _columns; // empty : all columns
+	Predicate _predicate;
+
+	// Follow state for 'refresh'
+	std::string _filename;
+	std::pair<uint64_t, uint64_t> _fileid;
+	File::SizeType _offset = 0; // end of the last complete line
+	File::SizeType _end = 0;    // end of what was read
+	bool _partial = false;      // the last row came from an unterminated line
+	size_t _recsize = 0;
 
 	void _load(TextFile &file) {
-		size_t recsize = 0;
+		if (!file.bad())
+			_fileid = _identity(file);
+		_parse(file);
+	}
+
+	void _parse(TextFile &file) {
+		const size_t first = row();
+		const size_t recsize = _recsize;
+		Fields fields;
 		while (!file.eof()) {
-			std::string line = file.getline();
+			auto line = file.getline_view();
+			bool complete = !file.eof();
+			if (complete)
+				_offset = static_cast<File::SizeType>(file.tell());
 			if (line.empty())
 				continue;
-			std::vector<std::string> dat;
-			Convert::split(line, ",", [&](const char *s) { dat.push_back(s); }, true, true);
-			recsize = std::max(dat.size(), recsize);
-			_data.push_back(dat);
+			_split(line, fields);
+			if (_predicate && !_predicate(fields))
+				continue;
+			_data->push_back(_select(fields));
+			_partial = !complete;
+			_recsize = std::max(_data->back().size(), _recsize);
 		}
-		for (auto &dat : _data) {
-			while (recsize > dat.size())
+		_end = static_cast<File::SizeType>(file.tell());
+		for (size_t r = (_recsize > recsize ? 0 : first); r < row(); ++r) {
+			auto &dat = (*_data)[r];
+			while (_recsize > dat.size())
 				dat.push_back("");
 		}
 	}
 
+	// Writable access to the table, for iterators handed out by non-const 'begin' and 'end'.
+	// From then on copies take their own table, the iterators may still write to this one.
+	void _detach() {
+		commit();
+		_unshare();
+		_unshareable = true;
+	}
+
+	void _unshare() {
+		if (_data.use_count() > 1)
+			_data = std::make_shared<Table>(*_data);
+	}
+
+	// (device, inode), to tell a rotated file from the same file grown.
+	static std::pair<uint64_t, uint64_t> _identity(const File &file) {
+#if PRILIB_OS_IS_UNIX(PRILIB_OS)
+		struct stat st;
+		if (fstat(fileno(file.c_ptr()), &st) == 0)
+			return std::make_pair(static_cast<uint64_t>(st.st_dev), static_cast<uint64_t>(st.st_ino));
+#endif
+		return std::make_pair(0, 0);
+	}
+
+	// Same as Convert::split(line, ",", ..., true, true), without copying.
+	static void _split(const StringViewRange &line, Fields &fields) {
+		fields.clear();
+		Convert::split(line, ',', [&](const StringViewRange &field) {
+			fields.push_back(field);
+		}, true, true);
+	}
+
+	std::vector<std::string> _select(const Fields &fields) const {
+		std::vector<std::string> dat;
+		if (_columns.empty()) {
+			dat.reserve(fields.size());
+			for (auto &field : fields)
+				dat.emplace_back(field.begin(), field.end());
+		}
+		else {
+			dat.reserve(_columns.size());
+			for (size_t column : _columns) {
+				if (column <= fields.size())
+					dat.emplace_back(fields[column - 1].begin(), fields[column - 1].end());
+				else
+					dat.emplace_back();
+			}
+		}
+		return dat;
+	}
+
+	// wcolumn : A, B, AA, ... (upper case)
+	static size_t _parse_column(const std::string &wcolumn) {
+		size_t column = 0;
+		size_t weights = 1;
+		for (auto iter = wcolumn.rbegin(); iter != wcolumn.rend(); ++iter) {
+			column += weights * ((*iter) - 'A' + 1);
+			weights *= 26;
+		}
+		return column;
+	}
+
 	static Size _parse_post(const std::string &word) {
 		std::string wcolumn;
 		std::string wrow;
@@ -132,18 +506,12 @@ private:
 				}
 			}
 		}
-		size_t column = 0;
 		size_t row = 0;
 		bool v = Convert::to_integer(wrow, row);
 		assert(v);
 		assert(wrow.size() <= log(std::numeric_limits<size_t>::max()) / log(26));
-		size_t weights = 1;
-		for (auto iter = wcolumn.rbegin(); iter != wcolumn.rend(); ++iter) {
-			column += weights * ((*iter) - 'A' + 1);
-			weights *= 26;
-		}
 
-		return Size { row, column };
+		return Size { row, _parse_column(wcolumn) };
 	}
 };
 PRILIB_END
@@ -0,0 +1,78 @@
+// durableappender.h
+// * PrivateLibrary
+// * Description:  Append-only file, records made durable in group commits.
+
+#pragma once
+#ifndef _PRILIB_DURABLEAPPENDER_H_
+#define _PRILIB_DURABLEAPPENDER_H_
+#include "macro.h"
+#include <string>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+PRILIB_BEGIN
+// Any thread may submit records. One writer thread takes everything submitted since its
+// last commit, writes it in one call and syncs once (fdatasync), then wakes the submitters.
+// The more threads submit at once, the more records share a sync.
+class DurableAppender
+{
+public:
+	using Ticket = uint64_t;
+
+public:
+	// 'capacity' : submitters wait while this many bytes are pending.
+	explicit DurableAppender(const std::string &filename, size_t capacity = 0x400000);
+	// Commit all submitted records, then stop the writer.
+	~DurableAppender();
+
+	DurableAppender(const DurableAppender&) = delete;
+	DurableAppender& operator=(const DurableAppender&) = delete;
+
+	bool bad() const {
+		return _fd == -1;
+	}
+
+	// Queue a record, return its ticket without waiting. 0 if the appender has failed.
+	Ticket submit(const void *data, size_t size);
+	Ticket submit(const std::string &record) {
+		return submit(record.data(), record.size());
+	}
+
+	// Wait until the record of 'ticket' and all before it are durable.
+	// Return false if a write or sync failed, the file is not appended to after that.
+	bool wait(Ticket ticket);
+
+	// Submit and wait.
+	bool append(const void *data, size_t size) {
+		Ticket ticket = submit(data, size);
+		return ticket != 0 && wait(ticket);
+	}
+	bool append(const std::string &record) {
+		return append(record.data(), record.size());
+	}
+
+	// Count of commits (write and sync) done.
+	uint64_t commits() const;
+
+private:
+	int _fd = -1;
+	size_t _capacity;
+	std::string _pending;
+	Ticket _submitted = 0;
+	Ticket _durable = 0;
+	uint64_t _commits = 0;
+	bool _failed = false;
+	bool _stop = false;
+	mutable std::mutex _mutex;
+	std::condition_variable _work;   // the writer waits for records
+	std::condition_variable _done;   // submitters wait for commits or room
+	std::thread _thread;
+
+	void _run();
+	bool _commit(const std::string &batch);
+};
+PRILIB_END
+
+#endif
@@ -0,0 +1,138 @@
+// externalsort.h
+// * PrivateLibrary
+// * Description:  Sort and group rows which do not fit in memory.
+
+#pragma once
+#ifndef _PRILIB_EXTERNALSORT_H_
+#define _PRILIB_EXTERNALSORT_H_
+#include "macro.h"
+#include "file.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <future>
+#include <functional>
+
+PRILIB_BEGIN
+// Rows are buffered up to the memory budget, sorted by a pool of threads and
+// spilled as runs into temporary files, then merged by a loser tree.
+// At most 'fanin' runs are merged at once : more runs are merged in passes,
+// so the count of open temporary files stays bounded.
+class ExternalSort
+{
+public:
+	using Row = std::vector<std::string>;
+	using Compare = std::function<bool(const Row&, const Row&)>;
+	using Yield = std::function<void(const Row&)>;
+
+	struct Options {
+		size_t memory;  // bytes of rows held at once, for all threads
+		size_t threads; // threads sorting and spilling runs
+		size_t fanin;   // runs merged at once, at least 2
+
+		Options(size_t memory = 0x4000000, size_t threads = 2, size_t fanin = 64)
+			: memory(memory), threads(threads), fanin(fanin) {}
+	};
+
+public:
+	explicit ExternalSort(Compare comp, const Options &options = Options());
+
+	// keys : 1, 2, ... , compared as strings in the given order.
+	explicit ExternalSort(const std::vector<size_t> &keys, const Options &options = Options());
+
+	~ExternalSort();
+
+	ExternalSort(const ExternalSort&) = delete;
+	ExternalSort& operator=(const ExternalSort&) = delete;
+
+	void push(const Row &row) {
+		push(Row(row));
+	}
+	void push(Row &&row);
+
+	// Push every line of a CSV file.
+	void load(TextFile &input);
+
+	// Yield all pushed rows in order (stable), then reset.
+	// Return false if a run could not be spilled, merged or read back.
+	bool sort(Yield yield);
+
+	// Write all pushed rows in order as CSV lines.
+	bool save(TextFile &output);
+
+	// The count of runs held or being spilled, after merges.
+	size_t runs() const {
+		return _runs.size() + _pending.size();
+	}
+
+	static size_t row_size(const Row &row);
+
+private:
+	Compare _comp;
+	Options _options;
+	std::vector<Row> _chunk;
+	size_t _chunksize = 0;
+	std::deque<std::future<BinaryFile>> _pending;
+	std::vector<BinaryFile> _runs;
+	std::vector<size_t> _levels; // of each run, see '_collapse'
+	bool _good = true;
+
+	void _spill();
+	void _wait(size_t pending);
+	void _collapse();
+	bool _merge(Yield yield);
+};
+
+// Aggregate rows sorted (or at least grouped) by the key columns,
+// yielding one row per group : key columns, then aggregates.
+class GroupBy
+{
+public:
+	using Row = ExternalSort::Row;
+	using Yield = ExternalSort::Yield;
+
+	enum Function {
+		Count,
+		Sum,
+		Min,
+		Max,
+		Mean,
+	};
+	struct Aggregate {
+		Function function;
+		size_t column; // 1, 2, ... (unused by Count)
+	};
+
+public:
+	explicit GroupBy(const std::vector<size_t> &keys, const std::vector<Aggregate> &aggregates, Yield yield);
+
+	void push(const Row &row);
+
+	// Yield the last group.
+	void finish();
+
+	// Adapter for ExternalSort::sort.
+	Yield yield() {
+		return [this](const Row &row) { push(row); };
+	}
+
+private:
+	struct State {
+		size_t count;
+		double value;
+	};
+
+	std::vector<size_t> _keys;
+	std::vector<Aggregate> _aggregates;
+	Yield _yield;
+	Row _current;
+	std::vector<State> _states;
+	bool _open = false;
+
+	bool _same(const Row &row) const;
+	void _reset(const Row &row);
+	void _emit();
+};
+PRILIB_END
+
+#endif
@@ -6,14 +6,21 @@
 #define _PRILIB_FILE_H_
 #include "macro.h"
 #include "convert.h"
+#include "stringview.h"
 #include <string>
 #include <memory>
+#include <cstdlib>
 
 PRILIB_BEGIN
+class LineIndex;
+
 class File
 {
 	using FilePtr = std::shared_ptr<FILE>;
 public:
+	using SizeType = uint64_t;
+	using OffsetType = int64_t;
+
 	enum TBMode {
 		Text,      // t
 		Binary,    // b
@@ -29,7 +36,7 @@ public:
 
 public:
 	explicit File()
-		: _file(nullptr), _size(0) {}
+		: _file(nullptr) {}
 
 	explicit File(FILE *fp, bool exclusive = false);
 
@@ -56,15 +63,46 @@ public:
 		return _file.get();
 	}
 
-	size_t size() const;
+	// Taken by 'fstat' when opened by name, or lazily on the first call when built from a FILE*.
+	// 0 for pipes, terminals, ... (see 'sized').
+	SizeType size() const;
+	// Whether the file has a size (a regular file).
+	bool sized() const;
 	bool eof() const;
 
+	// 64-bit stream position.
+	OffsetType tell() const;
+	bool seek(OffsetType offset, int origin = SEEK_SET);
+
+	// Copy 'length' bytes from 'offset' of this file (default to the end of file)
+	// to the position of 'dst', inside the kernel where possible
+	// (copy_file_range, then sendfile), else through a buffer.
+	// The position of this file is not used or moved, the position of 'dst' is advanced.
+	// Return the count of bytes copied.
+	SizeType copy_to(File &dst, SizeType offset = 0, SizeType length = static_cast<SizeType>(-1)) const;
+
+	// Write the stream buffer out to the file.
+	bool flush();
+
 protected:
+	// Grown by delimited reads, never shared between copies.
+	struct LineBuffer {
+		char *data = nullptr;
+		size_t capacity = 0;
+
+		LineBuffer() = default;
+		LineBuffer(const LineBuffer&) {}
+		LineBuffer& operator=(const LineBuffer&) { return *this; }
+		~LineBuffer() { std::free(data); }
+	};
+
 	FilePtr _file;
-	size_t _size;
+	mutable SizeType _size = 0;
+	mutable bool _sized = false;
+	mutable bool _sizeSet = false;
 
 	void _priOpen(const std::string &filename, TBMode tbmode, RWMode rwmode);
-	void _setSize();
+	void _setSize() const;
 	void _setPostBegin() const;
 	void _setPostEnd() const;
 
@@ -96,8 +134,19 @@ public:
 
 	std::string getline();
 
+	// Read a line (without '\n' or "\r\n") into 'line', reusing its capacity.
+	// Return false if nothing was read.
+	bool getline(std::string &line);
+
+	// Read a line into the internal buffer, valid until the next 'getline'.
+	StringViewRange getline_view();
+
+	// Seek to the start of line 'line' (from 0) by 'index', built for this file.
+	bool seek_line(uint64_t line, const LineIndex &index);
+
 	std::string getText() const;
 
+	// fscanf per value : see TokenReader for reading many.
 	template <typename T>
 	bool getfmt(T &element) {
 		return _getfmt(Convert::format<T>(), &element);
@@ -107,6 +156,8 @@ public:
 	void write(const std::string &str);
 
 private:
+	LineBuffer _line;
+
 	bool _getfmt(const char *fmt, void *dst);
 };
 
@@ -153,19 +204,30 @@ public:
 		return read(&element, 1);
 	}
 
+	// Positional I/O on the file descriptor, which does not use or move the stream position,
+	// so several threads can read (or write) one file at once without locking.
+	// 'write_at' bypasses the stream buffer : 'flush' before mixing it with 'write'.
+	// On Windows the handle position is put back after each call, which is not atomic :
+	// do not use the stream while other threads call 'read_at' or 'write_at'.
+	// Return the count of bytes read (less than 'size' at the end of file) or written.
+	size_t read_at(uint64_t offset, void *buffer, size_t size) const;
+	size_t write_at(uint64_t offset, const void *buffer, size_t size);
+
+	// Read up to 'delimit', which is dropped.
+	// Return false if nothing was read.
+	bool read_string(std::string &result, char delimit = '\0');
 	std::string read_string() {
 		std::string result;
-		char c;
-		while (read(c)) {
-			if (c) {
-				result.push_back(c);
-			}
-			else {
-				break;
-			}
-		}
+		read_string(result);
 		return result;
 	}
+
+	// Length-prefixed string : uint32_t length, then the bytes.
+	bool write_sized_string(const std::string &str);
+	bool read_sized_string(std::string &result);
+
+private:
+	LineBuffer _line;
 };
 
 class StdIn : public TextFile
@@ -0,0 +1,64 @@
+// lineindex.h
+// * PrivateLibrary
+// * Description:  Sparse index of line offsets, for random access to large text files.
+
+#pragma once
+#ifndef _PRILIB_LINEINDEX_H_
+#define _PRILIB_LINEINDEX_H_
+#include "macro.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+PRILIB_BEGIN
+// Lines are counted from 0, the offset of every 'step'-th line is kept.
+// An index stays valid for the lines it covers while the file is only appended to.
+class LineIndex
+{
+public:
+	explicit LineIndex() = default;
+
+	explicit LineIndex(const std::string &filename, size_t step = 0x400, size_t threads = 1) {
+		build(filename, step, threads);
+	}
+
+	// Scan the file, in 'threads' chunks at once.
+	bool build(const std::string &filename, size_t step = 0x400, size_t threads = 1);
+
+	// The sidecar file : magic, varint step, lines, file size, count, then varint deltas of the offsets.
+	bool save(const std::string &indexname) const;
+	bool load(const std::string &indexname);
+
+	static std::string sidecar(const std::string &filename) {
+		return filename + ".lidx";
+	}
+
+	// The count of lines ('\n' ended, and a last line without '\n').
+	uint64_t lines() const {
+		return _lines;
+	}
+	// The size of the file indexed.
+	uint64_t size() const {
+		return _size;
+	}
+	size_t step() const {
+		return _step;
+	}
+
+	// The offset of the nearest indexed line at or before 'line',
+	// 'skip' gets the count of lines from there to 'line'.
+	uint64_t offset(uint64_t line, uint64_t &skip) const {
+		size_t i = static_cast<size_t>(line / _step);
+		skip = line - static_cast<uint64_t>(i) * _step;
+		return _offsets[i];
+	}
+
+private:
+	size_t _step = 1;
+	uint64_t _lines = 0;
+	uint64_t _size = 0;
+	std::vector<uint64_t> _offsets;
+};
+PRILIB_END
+
+#endif
@@ -0,0 +1,87 @@
+// mappedfile.h
+// * PrivateLibrary
+// * Description:  Read-only memory mapped file.
+
+#pragma once
+#ifndef _PRILIB_MAPPEDFILE_H_
+#define _PRILIB_MAPPEDFILE_H_
+#include "macro.h"
+#include "stringview.h"
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cassert>
+
+PRILIB_BEGIN
+class MappedFile
+{
+public:
+	using SizeType = uint64_t;
+
+	enum Advice {
+		Normal,
+		Sequential,
+		Random,
+		WillNeed,
+		DontNeed,
+		HugePage,   // Transparent huge pages, where the kernel supports them for the file
+	};
+	enum Flag {
+		None = 0,
+		Populate = 1,   // Fault in all pages when mapping
+		HugePages = 2,  // Advise HugePage when mapping
+	};
+
+public:
+	explicit MappedFile() = default;
+
+	explicit MappedFile(const std::string &filename, int flags = None) {
+		_priOpen(filename, flags);
+	}
+
+	MappedFile& open(const std::string &filename, int flags = None) {
+		_priOpen(filename, flags);
+		return *this;
+	}
+	MappedFile& close() {
+		_map = nullptr;
+		return *this;
+	}
+
+	bool bad() const {
+		return _map == nullptr;
+	}
+
+	const char* data() const;
+	SizeType size() const;
+
+	const char* begin() const {
+		return data();
+	}
+	const char* end() const {
+		return data() + size();
+	}
+
+	StringViewRange view() const {
+		return StringViewRange(data(), static_cast<size_t>(size()));
+	}
+	StringViewRange view(SizeType offset, size_t length) const {
+		assert(offset + length <= size());
+		return StringViewRange(data() + offset, length);
+	}
+
+	// Return false if the hint is not supported.
+	bool advise(Advice advice) const {
+		return advise(advice, 0, size());
+	}
+	bool advise(Advice advice, SizeType offset, SizeType length) const;
+
+private:
+	class Mapping;
+	std::shared_ptr<Mapping> _map;
+
+	void _priOpen(const std::string &filename, int flags);
+};
+PRILIB_END
+
+#endif
@@ -0,0 +1,72 @@
+// prefetchreader.h
+// * PrivateLibrary
+// * Description:  Sequential reader filling its next buffers on a background thread.
+
+#pragma once
+#ifndef _PRILIB_PREFETCHREADER_H_
+#define _PRILIB_PREFETCHREADER_H_
+#include "macro.h"
+#include "file.h"
+#include "stringview.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+PRILIB_BEGIN
+// While the caller consumes one chunk, up to 'depth' more are read by the background thread.
+// The reader owns the file from its current position to the end : the file must not be used
+// directly while the reader is alive, and is left wherever the read-ahead stopped.
+class PrefetchReader
+{
+public:
+	explicit PrefetchReader(const File &file, size_t capacity = 0x100000, size_t depth = 2);
+	~PrefetchReader();
+
+	PrefetchReader(const PrefetchReader&) = delete;
+	PrefetchReader& operator=(const PrefetchReader&) = delete;
+
+	// The rest of the current chunk, then the next chunks in order.
+	// Valid until the next call of any read method. Empty at the end of file.
+	StringViewRange next();
+
+	// Return the count of bytes read.
+	size_t read(void *data, size_t size);
+
+	// Read a line (without '\n' or "\r\n").
+	// Return false if nothing was read.
+	bool getline(std::string &line);
+
+	// May wait for the next chunk.
+	bool eof();
+
+private:
+	struct Buffer {
+		std::unique_ptr<char[]> data;
+		size_t size;
+	};
+
+	File _file;
+	size_t _capacity;
+	std::vector<Buffer> _buffers;
+	std::deque<size_t> _free;
+	std::deque<size_t> _ready;
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	bool _stop = false;
+	std::thread _thread;
+
+	size_t _current;       // the chunk being consumed
+	size_t _pos = 0;       // in the current chunk
+	bool _hold = false;    // holding the current chunk
+	bool _end = false;
+
+	void _run();
+	bool _advance();
+};
+PRILIB_END
+
+#endif
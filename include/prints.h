@@ -11,20 +11,30 @@
 #include <string>
 
 PRILIB_BEGIN
+class StringBuilder;
+
 namespace Output
 {
 	// Print
 	template <typename T>
-	inline void print(const T &obj)
+	inline typename std::enable_if<!Convert::IsNumber<T>::value>::type print(const T &obj)
 	{
 		using Convert::to_string;
-		using std::to_string;
 		std::printf("%s", to_string(obj).c_str());
 	}
+	template <typename T>
+	inline typename std::enable_if<Convert::IsNumber<T>::value>::type print(const T &obj)
+	{
+		char buffer[Convert::chars_size];
+		char *end = Convert::to_chars(buffer, buffer + Convert::chars_size, obj);
+		std::fwrite(buffer, sizeof(char), end - buffer, stdout);
+	}
 	inline void print(const char *str)
 	{
 		std::printf("%s", str);
 	}
+	// The text in the builder, written as is (see stringbuilder.h).
+	void print(const StringBuilder &builder);
 	template <typename First, typename... Rest>
 	inline void print(const First& first, const Rest&... rest)
 	{
@@ -43,6 +53,11 @@ namespace Output
 		print<T>(obj);
 		println();
 	}
+	inline void println(const StringBuilder &builder)
+	{
+		print(builder);
+		println();
+	}
 	template <typename First, typename... Rest>
 	inline void println(const First& first, const Rest&... rest)
 	{
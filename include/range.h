@@ -216,7 +216,6 @@ template <typename T1, typename T2>
 inline std::string to_string(const RangeBase<T1, T2> &r)
 {
 	using Convert::to_string;
-	using std::to_string;
 
 	return "range(" + to_string(r._begin) + "," + to_string(r._end) + ")";
 }
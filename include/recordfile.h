@@ -0,0 +1,55 @@
+// recordfile.h
+// * PrivateLibrary
+// * Description:  Length-prefixed, checksummed records over a BinaryFile.
+
+#pragma once
+#ifndef _PRILIB_RECORDFILE_H_
+#define _PRILIB_RECORDFILE_H_
+#include "macro.h"
+#include "file.h"
+#include <string>
+#include <cstdint>
+
+PRILIB_BEGIN
+// CRC-32 (IEEE 802.3), continued from 'crc' for data in pieces.
+uint32_t crc32(const void *data, size_t size, uint32_t crc = 0);
+
+// Record : varint(length) payload crc32(payload)
+//  The checksum is 4 bytes, little endian.
+class RecordWriter
+{
+public:
+	explicit RecordWriter(BinaryFile &file)
+		: _file(file) {}
+
+	bool write(const void *data, size_t size);
+	bool write(const std::string &payload) {
+		return write(payload.data(), payload.size());
+	}
+
+private:
+	BinaryFile _file;
+};
+
+class RecordReader
+{
+public:
+	enum Status {
+		Ok,
+		End,      // no more records
+		Corrupt,  // truncated record or checksum mismatch
+	};
+
+public:
+	explicit RecordReader(BinaryFile &file, size_t maxsize = 0x40000000)
+		: _file(file), _maxsize(maxsize) {}
+
+	Status read(std::string &payload);
+
+private:
+	BinaryFile _file;
+	size_t _maxsize;
+};
+PRILIB_END
+
+#endif
@@ -0,0 +1,183 @@
+// stringbuilder.h
+// * PrivateLibrary
+// * Description:  Text built in one growing buffer, formatted in place by Convert.
+
+#pragma once
+#ifndef _PRILIB_STRINGBUILDER_H_
+#define _PRILIB_STRINGBUILDER_H_
+#include "macro.h"
+#include "convert.h"
+#include "stringview.h"
+#include "file.h"
+#include <string>
+#include <memory>
+#include <cstring>
+
+PRILIB_BEGIN
+// Short texts stay in the builder itself, longer ones double a heap buffer.
+// Every 'append' formats as the Convert::to_string of its argument, without the temporary string.
+// With a sink, the buffer stays at 'capacity' and is written to the file when full (and when destroyed).
+class StringBuilder
+{
+public:
+	static constexpr size_t inline_size = 256;
+
+public:
+	explicit StringBuilder()
+		: _data(_inline), _capacity(inline_size) {}
+	explicit StringBuilder(size_t capacity)
+		: StringBuilder() {
+		reserve(capacity);
+	}
+	explicit StringBuilder(File &sink, size_t capacity = 0x10000)
+		: StringBuilder(capacity) {
+		_sink = sink;
+	}
+	~StringBuilder() {
+		flush();
+	}
+
+	StringBuilder(const StringBuilder&) = delete;
+	StringBuilder& operator=(const StringBuilder&) = delete;
+
+	// Text
+	StringBuilder& append(const char *data, size_t size) {
+		if (size <= _capacity - _size) {
+			std::memcpy(_data + _size, data, size);
+			_size += size;
+			return *this;
+		}
+		return _append(data, size);
+	}
+	StringBuilder& append(const std::string &str) {
+		return append(str.data(), str.size());
+	}
+	StringBuilder& append(const StringViewRange &str) {
+		return append(str.begin(), str.size());
+	}
+	StringBuilder& append(const char *s) {
+		return append(s, std::strlen(s));
+	}
+	StringBuilder& append(char c) {
+		*_room(1) = c;
+		++_size;
+		return *this;
+	}
+	StringBuilder& append(char c, size_t count);
+
+	// Values, as Convert::to_string
+	StringBuilder& append(std::nullptr_t) {
+		return append("Null", 4);
+	}
+	StringBuilder& append(bool b) {
+		return append(b ? 'T' : 'F');
+	}
+	StringBuilder& append(const void *p);
+	template <typename T>
+	typename std::enable_if<Convert::IsNumber<T>::value, StringBuilder&>::type append(T value) {
+		char *p = _room(Convert::chars_size);
+		_size = Convert::to_chars(p, p + Convert::chars_size, value) - _data;
+		return *this;
+	}
+	// Others through their own to_string.
+	template <typename T>
+	typename std::enable_if<!Convert::IsNumber<T>::value, StringBuilder&>::type append(const T &value) {
+		using Convert::to_string;
+		return append(to_string(value));
+	}
+
+	// As Convert::to_hex : an integer in all its digits, or bytes between separators.
+	template <typename T>
+	typename std::enable_if<std::is_integral<T>::value, StringBuilder&>::type append_hex(T value) {
+		static const char digits[] = "0123456789abcdef";
+		using U = typename std::make_unsigned<T>::type;
+		U u = static_cast<U>(value);
+		char *p = _room(sizeof(T) * 2);
+		for (size_t i = sizeof(T) * 2; i-- != 0; u >>= 4)
+			p[i] = digits[u & 0xf];
+		_size += sizeof(T) * 2;
+		return *this;
+	}
+	StringBuilder& append_hex(const void *src, size_t size, char separator = ' ');
+
+	// As Convert::to_string<B, E, D>(begin, end).
+	template <char B = '\0', char E = '\0', char D = '\0', typename Iter>
+	StringBuilder& append_range(Iter begin, Iter end) {
+		Convert::JoinFormat<B, E, D> format;
+		return append_join(begin, end, format.delimiter, format.prefix, format.suffix);
+	}
+	// As Convert::join.
+	template <typename Iter>
+	StringBuilder& append_join(Iter begin, Iter end, const std::string &delimiter = ", ", const std::string &prefix = std::string(), const std::string &suffix = std::string()) {
+		append(prefix);
+		if (begin != end) {
+			append(*begin);
+			while (++begin != end)
+				append(delimiter).append(*begin);
+		}
+		return append(suffix);
+	}
+
+	template <typename T>
+	StringBuilder& operator<<(const T &value) {
+		return append(value);
+	}
+
+	// Make room for 'size' more chars (flushing the sink first when they do not fit).
+	void reserve(size_t size) {
+		_room(size);
+	}
+
+	const char* data() const {
+		return _data;
+	}
+	size_t size() const {
+		return _size;
+	}
+	bool empty() const {
+		return _size == 0;
+	}
+	void clear() {
+		_size = 0;
+	}
+	std::string str() const {
+		return std::string(_data, _size);
+	}
+	StringViewRange view() const {
+		return StringViewRange(_data, _size);
+	}
+
+	// Write the buffer to the sink, and clear it.
+	// Return false if any write to the sink failed, true without a sink.
+	bool flush();
+
+	bool good() const {
+		return _good;
+	}
+
+private:
+	char _inline[inline_size];
+	std::unique_ptr<char[]> _heap;
+	char *_data;
+	size_t _size = 0;
+	size_t _capacity;
+	File _sink;
+	bool _good = true;
+
+	// A pointer to 'size' writable chars at the end.
+	char* _room(size_t size) {
+		if (size > _capacity - _size)
+			_grow(size);
+		return _data + _size;
+	}
+	void _grow(size_t size);
+	StringBuilder& _append(const char *data, size_t size);
+};
+
+inline std::string to_string(const StringBuilder &builder)
+{
+	return builder.str();
+}
+PRILIB_END
+
+#endif
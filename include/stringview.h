@@ -89,6 +89,10 @@ public:
 		return _size;
 	}
 
+	bool empty() const {
+		return _size == 0;
+	}
+
 	char operator[](OffsetType offset) const {
 		assert((offset >= 0 && static_cast<SizeType>(offset) < _size) || (offset < 0 && static_cast<SizeType>(-offset) <= _size));
 		return (offset >= 0) ? (_data[offset]) : (_data[_size + offset]);
@@ -0,0 +1,81 @@
+// tokenreader.h
+// * PrivateLibrary
+// * Description:  Whitespace separated values parsed straight from a buffer, without scanf.
+
+#pragma once
+#ifndef _PRILIB_TOKENREADER_H_
+#define _PRILIB_TOKENREADER_H_
+#include "macro.h"
+#include "file.h"
+#include "bufferedfile.h"
+#include <string>
+
+PRILIB_BEGIN
+// For the hot paths of TextFile::getfmt.
+// A token is what lies between whitespace, and must be parsed whole : "12abc" is not an int.
+// A token that fails to parse is left unread, to be read as another type.
+// Tokens longer than 'capacity' are split.
+// As with BufferedBinaryReader, the file must not be used directly while the reader is alive.
+class TokenReader
+{
+public:
+	explicit TokenReader(TextFile &file, size_t capacity = 0x10000)
+		: _file(file), _reader(_file, capacity) {}
+
+	TokenReader(const TokenReader&) = delete;
+	TokenReader& operator=(const TokenReader&) = delete;
+
+	template <typename T>
+	bool read(T &value) {
+		const char *begin, *end;
+		if (!_token(begin, end) || !_parse(begin, end, value))
+			return false;
+		_reader.consume(end - _reader.window());
+		return true;
+	}
+	// The next non-whitespace character.
+	bool read(char &value);
+	bool read(std::string &value);
+
+	// Return the count of values read.
+	template <typename T>
+	size_t read_n(T *dst, size_t count) {
+		size_t i = 0;
+		while (i != count && read(dst[i]))
+			++i;
+		return i;
+	}
+
+	// No token left.
+	bool eof() {
+		const char *begin, *end;
+		return !_token(begin, end);
+	}
+
+	// Give the unread position back to the file.
+	void release() {
+		_reader.release();
+	}
+
+private:
+	BinaryFile _file;
+	BufferedBinaryReader _reader;
+
+	// Skip whitespace, and make the whole next token lie in the window.
+	bool _token(const char *&begin, const char *&end);
+
+	static bool _parse(const char *begin, const char *end, short &value);
+	static bool _parse(const char *begin, const char *end, int &value);
+	static bool _parse(const char *begin, const char *end, long &value);
+	static bool _parse(const char *begin, const char *end, long long &value);
+	static bool _parse(const char *begin, const char *end, unsigned short &value);
+	static bool _parse(const char *begin, const char *end, unsigned &value);
+	static bool _parse(const char *begin, const char *end, unsigned long &value);
+	static bool _parse(const char *begin, const char *end, unsigned long long &value);
+	static bool _parse(const char *begin, const char *end, float &value);
+	static bool _parse(const char *begin, const char *end, double &value);
+	static bool _parse(const char *begin, const char *end, long double &value);
+};
+PRILIB_END
+
+#endif
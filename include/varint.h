@@ -0,0 +1,94 @@
+// varint.h
+// * PrivateLibrary
+// * Description:  LEB128 variable-length integers and zigzag encoding.
+
+#pragma once
+#ifndef _PRILIB_VARINT_H_
+#define _PRILIB_VARINT_H_
+#include "macro.h"
+#include "memory.h"
+#include <cstdint>
+#include <cstddef>
+
+PRILIB_BEGIN
+namespace Varint
+{
+	// The most bytes of an encoded uint64_t.
+	constexpr size_t max_size = 10;
+
+	// Zigzag : 0 -1 1 -2 2 ... -> 0 1 2 3 4 ...
+	inline uint64_t zigzag(int64_t value)
+	{
+		return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+	}
+	inline int64_t unzigzag(uint64_t value)
+	{
+		return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+	}
+
+	inline size_t size(uint64_t value)
+	{
+		size_t n = 1;
+		while (value >= 0x80) {
+			value >>= 7;
+			++n;
+		}
+		return n;
+	}
+
+	// dst : at least 'size(value)' bytes.
+	// Return the count of bytes written.
+	inline size_t encode(uint64_t value, byte *dst)
+	{
+		size_t n = 0;
+		while (value >= 0x80) {
+			dst[n++] = static_cast<byte>(value | 0x80);
+			value >>= 7;
+		}
+		dst[n++] = static_cast<byte>(value);
+		return n;
+	}
+
+	// Return the count of bytes read, 0 if truncated, longer than 'max_size' or over 64 bits.
+	inline size_t decode(const byte *src, const byte *end, uint64_t &value)
+	{
+		uint64_t result = 0;
+		for (size_t n = 0; n != max_size && src + n != end; ++n) {
+			// The last byte holds bit 63 only.
+			if (n == max_size - 1 && src[n] > 1)
+				return 0;
+			result |= static_cast<uint64_t>(src[n] & 0x7f) << (7 * n);
+			if ((src[n] & 0x80) == 0) {
+				value = result;
+				return n + 1;
+			}
+		}
+		return 0;
+	}
+
+	// Signed values, zigzag first.
+	inline size_t encode_signed(int64_t value, byte *dst)
+	{
+		return encode(zigzag(value), dst);
+	}
+	inline size_t decode_signed(const byte *src, const byte *end, int64_t &value)
+	{
+		uint64_t v;
+		size_t n = decode(src, end, v);
+		if (n != 0)
+			value = unzigzag(v);
+		return n;
+	}
+
+	// dst : at least 'count * max_size' bytes.
+	// Return the count of bytes written.
+	size_t encode_n(const uint64_t *src, size_t count, byte *dst);
+
+	// Decode up to 'count' values, stopping at 'end' or at a malformed value.
+	// Whole runs of one-byte values are decoded 16 at a time (SSE2), others a word at a time.
+	// Return the count of values decoded, 'used' gets the count of bytes read.
+	size_t decode_n(const byte *src, const byte *end, uint64_t *dst, size_t count, size_t *used = nullptr);
+}
+PRILIB_END
+
+#endif
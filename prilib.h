@@ -6,29 +6,40 @@
 #ifndef _PRILIB_H_
 #define _PRILIB_H_
 
+#include "include/batchloader.h"
 #include "include/bijectionmap.h"
+#include "include/bufferedfile.h"
 #include "include/bytepool.h"
 #include "include/charptr.h"
 #include "include/convert.h"
 #include "include/csvloader.h"
 #include "include/dllloader.h"
+#include "include/durableappender.h"
 #include "include/dyarray.h"
 #include "include/explicittype.h"
+#include "include/externalsort.h"
 #include "include/file.h"
 #include "include/indextable.h"
 #include "include/lightlist.h"
+#include "include/lineindex.h"
 #include "include/macro.h"
+#include "include/mappedfile.h"
 #include "include/matrix.h"
 #include "include/memory.h"
+#include "include/prefetchreader.h"
 #include "include/prints.h"
 #include "include/random.h"
 #include "include/range.h"
 #include "include/rational-convert.h"
 #include "include/rational.h"
 #include "include/record.h"
+#include "include/recordfile.h"
 #include "include/storeptr.h"
+#include "include/stringbuilder.h"
 #include "include/stringview.h"
 #include "include/timer.h"
+#include "include/tokenreader.h"
 #include "include/uniqueptrvector.h"
+#include "include/varint.h"
 
 #endif
@@ -0,0 +1,140 @@
+#include "batchloader.h"
+#include "file.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cerrno>
+
+#if PRILIB_OS_IS_UNIX(PRILIB_OS)
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
+PRILIB_BEGIN
+//========================
+// * Read
+//========================
+
+#if PRILIB_OS_IS_UNIX(PRILIB_OS)
+// One open, fstat and read of the exact size : no stdio buffer for whole-file loads.
+static int read_whole(int fd, size_t size, std::string &text)
+{
+	// 'size' is only a hint for files like those in /proc.
+	text.resize(size != 0 ? size : 0x1000);
+	size_t length = 0;
+	for (;;) {
+		if (length == text.size()) {
+			if (size != 0) {
+				// Probe for growth since fstat.
+				char c;
+				ssize_t n = ::read(fd, &c, 1);
+				if (n == 0)
+					break;
+				if (n < 0) {
+					if (errno == EINTR) continue;
+					return errno;
+				}
+				text.push_back(c);
+				++length;
+			}
+			text.resize(text.size() * 2);
+		}
+		ssize_t n = ::read(fd, &text[length], text.size() - length);
+		if (n == 0)
+			break;
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return errno;
+		}
+		length += static_cast<size_t>(n);
+	}
+	text.resize(length);
+	return 0;
+}
+#endif
+
+BatchLoader::Entry BatchLoader::load(const std::string &filename) const {
+	Entry entry;
+	auto map = [&]() {
+		errno = 0;
+		entry.map.open(filename);
+		entry.mapped = !entry.map.bad();
+		if (!entry.mapped)
+			entry.error = errno ? errno : EIO;
+	};
+	if (_mode == Map) {
+		map();
+		return entry;
+	}
+#if PRILIB_OS_IS_UNIX(PRILIB_OS)
+	int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		entry.error = errno;
+		return entry;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		entry.error = errno;
+	}
+	else if (_mode == Auto && S_ISREG(st.st_mode) && static_cast<uint64_t>(st.st_size) >= _threshold) {
+		::close(fd);
+		map();
+		return entry;
+	}
+	else {
+		entry.error = read_whole(fd, S_ISREG(st.st_mode) ? static_cast<size_t>(st.st_size) : 0, entry.text);
+	}
+	::close(fd);
+#else
+	errno = 0;
+	BinaryFile file(filename);
+	if (file.bad()) {
+		entry.error = errno ? errno : ENOENT;
+		return entry;
+	}
+	if (_mode == Auto && file.sized() && file.size() >= _threshold) {
+		file.close();
+		map();
+		return entry;
+	}
+	entry.text.resize(static_cast<size_t>(file.size()));
+	if (!entry.text.empty() && !file.read(&entry.text[0], entry.text.size()))
+		entry.error = errno ? errno : EIO;
+#endif
+	if (!entry.good())
+		entry.text.clear();
+	return entry;
+}
+
+//========================
+// * Pool
+//========================
+
+void BatchLoader::load(const std::vector<std::string> &filenames, Callback callback) const {
+	// Workers take the next file from a shared counter, so slow files do not hold up a fixed share.
+	std::atomic<size_t> next(0);
+	auto work = [&]() {
+		size_t i;
+		while ((i = next.fetch_add(1)) < filenames.size()) {
+			Entry entry = load(filenames[i]);
+			callback(i, entry);
+		}
+	};
+	size_t threads = std::min(_threads, filenames.size());
+	std::vector<std::thread> pool;
+	for (size_t i = 1; i < threads; ++i)
+		pool.emplace_back(work);
+	work();
+	for (auto &t : pool)
+		t.join();
+}
+
+std::vector<BatchLoader::Entry> BatchLoader::load(const std::vector<std::string> &filenames) const {
+	std::vector<Entry> entries(filenames.size());
+	load(filenames, [&](size_t index, Entry &entry) {
+		entries[index] = std::move(entry);
+	});
+	return entries;
+}
+PRILIB_END
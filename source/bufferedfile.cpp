@@ -0,0 +1,277 @@
+#include "bufferedfile.h"
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+
+#if (PRILIB_OS == PRILIB_OS_WINDOWS)
+#	include <cstdio>
+#else
+#	include <sys/uio.h>
+#	include <unistd.h>
+#	include <climits>
+#endif
+
+PRILIB_BEGIN
+// On Unix the buffers go straight to the descriptor, with writev/readv.
+// Elsewhere through the unlocked stdio calls.
+#if (PRILIB_OS == PRILIB_OS_WINDOWS)
+struct IOVec {
+	char *base;
+	size_t size;
+};
+
+static bool write_all(FILE *fp, std::vector<IOVec> &iov)
+{
+	for (auto &v : iov) {
+		if (v.size != 0 && _fwrite_nolock(v.base, 1, v.size, fp) != v.size)
+			return false;
+	}
+	return true;
+}
+
+// Return the count of bytes read, 0 at end of file.
+static size_t read_some(FILE *fp, std::vector<IOVec> &iov)
+{
+	size_t total = 0;
+	for (auto &v : iov) {
+		size_t n = _fread_nolock(v.base, 1, v.size, fp);
+		total += n;
+		if (n != v.size)
+			break;
+	}
+	return total;
+}
+
+static void sync_position(BinaryFile &file, size_t unread)
+{
+	if (unread != 0)
+		file.seek(-static_cast<File::OffsetType>(unread), SEEK_CUR);
+}
+#else
+#	if !defined(IOV_MAX)
+#		define IOV_MAX 16
+#	endif
+using IOVec = iovec;
+
+static bool write_all(FILE *fp, std::vector<IOVec> &iov)
+{
+	int fd = fileno(fp);
+	size_t i = 0;
+	while (i != iov.size()) {
+		ssize_t n = ::writev(fd, iov.data() + i, static_cast<int>(std::min<size_t>(iov.size() - i, IOV_MAX)));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return false;
+		size_t step = static_cast<size_t>(n);
+		while (i != iov.size() && step >= iov[i].iov_len) {
+			step -= iov[i].iov_len;
+			++i;
+		}
+		if (step != 0) {
+			iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + step;
+			iov[i].iov_len -= step;
+		}
+	}
+	return true;
+}
+
+static size_t read_some(FILE *fp, std::vector<IOVec> &iov)
+{
+	int fd = fileno(fp);
+	while (true) {
+		ssize_t n = ::readv(fd, iov.data(), static_cast<int>(std::min<size_t>(iov.size(), IOV_MAX)));
+		if (n < 0 && errno == EINTR)
+			continue;
+		return n < 0 ? 0 : static_cast<size_t>(n);
+	}
+}
+
+// Move the stream to the descriptor position, less the unread bytes.
+static void sync_position(BinaryFile &file, size_t unread)
+{
+	off_t pos = ::lseek(fileno(file.c_ptr()), 0, SEEK_CUR);
+	if (pos >= 0)
+		file.seek(static_cast<File::OffsetType>(pos) - static_cast<File::OffsetType>(unread));
+}
+#endif
+
+static IOVec make_iovec(const void *data, size_t size)
+{
+	IOVec v;
+#if (PRILIB_OS == PRILIB_OS_WINDOWS)
+	v.base = static_cast<char*>(const_cast<void*>(data));
+	v.size = size;
+#else
+	v.iov_base = const_cast<void*>(data);
+	v.iov_len = size;
+#endif
+	return v;
+}
+
+//========================
+// * BufferedBinaryWriter
+//========================
+
+BufferedBinaryWriter::BufferedBinaryWriter(BinaryFile &file, size_t capacity)
+	: _file(file), _buffer(new char[capacity]), _capacity(capacity), _good(!file.bad()) {
+	if (_good)
+		_good = _file.flush();
+}
+
+bool BufferedBinaryWriter::writev(const Span *spans, size_t count) {
+	size_t total = 0;
+	for (size_t i = 0; i != count; ++i)
+		total += spans[i].size;
+	if (_size + total <= _capacity) {
+		for (size_t i = 0; i != count; ++i) {
+			std::memcpy(_buffer.get() + _size, spans[i].data, spans[i].size);
+			_size += spans[i].size;
+		}
+		return _good;
+	}
+	return _drain(spans, count);
+}
+
+bool BufferedBinaryWriter::release() {
+	if (_released)
+		return _good;
+	flush();
+	if (!_file.bad())
+		sync_position(_file, 0);
+	_released = true;
+	return _good;
+}
+
+// Write the buffer, then the spans, in one gather.
+bool BufferedBinaryWriter::_drain(const Span *spans, size_t count) {
+	if (!_good)
+		return false;
+	std::vector<IOVec> iov;
+	iov.reserve(count + 1);
+	if (_size != 0)
+		iov.push_back(make_iovec(_buffer.get(), _size));
+	for (size_t i = 0; i != count; ++i) {
+		if (spans[i].size != 0)
+			iov.push_back(make_iovec(spans[i].data, spans[i].size));
+	}
+	_size = 0;
+	if (!iov.empty())
+		_good = write_all(_file.c_ptr(), iov);
+	return _good;
+}
+
+//========================
+// * BufferedBinaryReader
+//========================
+
+BufferedBinaryReader::BufferedBinaryReader(BinaryFile &file, size_t capacity)
+	: _file(file), _buffer(new char[capacity]), _capacity(capacity), _eof(file.bad()) {
+	// Drop what stdio has read ahead, so the descriptor is at the stream position.
+	if (!_eof)
+		_file.flush();
+}
+
+size_t BufferedBinaryReader::readv(const Span *spans, size_t count) {
+	size_t total = 0;
+	size_t i = 0;
+	size_t offset = 0; // in spans[i]
+	while (i != count) {
+		char *data = static_cast<char*>(spans[i].data);
+		if (offset == spans[i].size) {
+			++i;
+			offset = 0;
+			continue;
+		}
+		if (available() != 0) {
+			size_t step = std::min(available(), spans[i].size - offset);
+			std::memcpy(data + offset, window(), step);
+			_begin += step;
+			offset += step;
+			total += step;
+			continue;
+		}
+		if (_eof)
+			break;
+
+		size_t rest = spans[i].size - offset;
+		for (size_t j = i + 1; j != count; ++j)
+			rest += spans[j].size;
+		if (rest < _capacity) {
+			fill();
+			continue;
+		}
+
+		// Large : read into the spans, and into the buffer behind them.
+		std::vector<IOVec> iov;
+		iov.push_back(make_iovec(data + offset, spans[i].size - offset));
+		for (size_t j = i + 1; j != count; ++j) {
+			if (spans[j].size != 0)
+				iov.push_back(make_iovec(spans[j].data, spans[j].size));
+		}
+		iov.push_back(make_iovec(_buffer.get(), _capacity));
+		size_t n = read_some(_file.c_ptr(), iov);
+		if (n == 0) {
+			_eof = true;
+			break;
+		}
+		while (i != count && n != 0) {
+			size_t step = std::min(n, spans[i].size - offset);
+			offset += step;
+			total += step;
+			n -= step;
+			if (offset == spans[i].size) {
+				++i;
+				offset = 0;
+			}
+		}
+		_begin = 0;
+		_end = n;
+	}
+	return total;
+}
+
+bool BufferedBinaryReader::read_string(std::string &result, char delimit) {
+	result.clear();
+	bool read = false;
+	while (available() != 0 || fill()) {
+		read = true;
+		auto p = static_cast<const char*>(std::memchr(window(), delimit, available()));
+		if (p != nullptr) {
+			result.append(window(), p);
+			consume(p - window() + 1);
+			return true;
+		}
+		result.append(window(), available());
+		consume(available());
+	}
+	return read;
+}
+
+bool BufferedBinaryReader::fill() {
+	if (_begin != 0) {
+		std::memmove(_buffer.get(), window(), available());
+		_end -= _begin;
+		_begin = 0;
+	}
+	if (_eof || _end == _capacity)
+		return false;
+	std::vector<IOVec> iov(1, make_iovec(_buffer.get() + _end, _capacity - _end));
+	size_t n = read_some(_file.c_ptr(), iov);
+	if (n == 0) {
+		_eof = true;
+		return false;
+	}
+	_end += n;
+	return true;
+}
+
+void BufferedBinaryReader::release() {
+	if (_released)
+		return;
+	if (!_file.bad())
+		sync_position(_file, available());
+	_begin = _end = 0;
+	_released = true;
+}
+PRILIB_END
@@ -0,0 +1,141 @@
+#include "convert.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if (PRILIB_ARCH == PRILIB_ARCH_x64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#	include <emmintrin.h>
+#	define PRILIB_COLUMN_SSE2 1
+#endif
+
+PRILIB_BEGIN
+namespace Convert
+{
+#if defined(PRILIB_COLUMN_SSE2)
+	static uint64_t load_eight(const char *p)
+	{
+		uint64_t word;
+		std::memcpy(&word, p, sizeof(word));
+		return word;
+	}
+
+	// The 9 to 16 decimal digits of [first, first + length), as one number.
+	// Two 8-byte loads inside the field, the first shifted right-aligned after '0's,
+	// then digits are paired, quadrupled and octupled by madd.
+	static bool parse_sixteen(const char *first, size_t length, uint64_t &result)
+	{
+		const unsigned pad = static_cast<unsigned>(16 - length) * 8;
+		uint64_t high = load_eight(first) << pad;
+		if (pad != 0)
+			high |= 0x3030303030303030ull >> (64 - pad);
+		uint64_t low = load_eight(first + length - 8);
+		__m128i v = _mm_set_epi64x(static_cast<long long>(low), static_cast<long long>(high));
+
+		const __m128i zero = _mm_set1_epi8('0');
+		const __m128i nine = _mm_set1_epi8(9);
+		__m128i d = _mm_sub_epi8(v, zero);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(d, nine), nine)) != 0xffff)
+			return false;
+
+		const __m128i z = _mm_setzero_si128();
+		__m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(d, z), _mm_setr_epi16(10, 1, 10, 1, 10, 1, 10, 1));
+		__m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(d, z), _mm_setr_epi16(10, 1, 10, 1, 10, 1, 10, 1));
+		__m128i quads = _mm_madd_epi16(_mm_packs_epi32(lo, hi), _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+		__m128i eights = _mm_madd_epi16(_mm_packs_epi32(quads, quads), _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+		uint32_t upper = static_cast<uint32_t>(_mm_cvtsi128_si32(eights));
+		uint32_t lower = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(eights, 4)));
+		result = static_cast<uint64_t>(upper) * 100000000 + lower;
+		return true;
+	}
+#endif
+
+	template <typename T>
+	static bool parse_field(const char *first, const char *last, T &result)
+	{
+#if defined(PRILIB_COLUMN_SSE2)
+		const char *p = first;
+		bool negative = false;
+		if (p != last && (*p == '-' || *p == '+')) {
+			negative = (*p++ == '-');
+			if (negative && !std::is_signed<T>::value)
+				return false;
+		}
+		const size_t length = last - p;
+		if (length - 9 < 8) {
+			uint64_t value;
+			if (!parse_sixteen(p, length, value))
+				return false;
+			if (value > static_cast<uint64_t>(std::numeric_limits<T>::max()) + (negative ? 1 : 0))
+				return false;
+			result = static_cast<T>(negative ? 0 - value : value);
+			return true;
+		}
+#endif
+		return from_chars(first, last, result);
+	}
+	static bool parse_field(const char *first, const char *last, double &result)
+	{
+		return from_chars(first, last, result);
+	}
+	static bool parse_field(const char *first, const char *last, float &result)
+	{
+		return from_chars(first, last, result);
+	}
+
+	template <typename T>
+	static size_t parse_column(const StringViewRange *src, size_t count, T *dst, T invalid, uint8_t *errors)
+	{
+		size_t failed = 0;
+		for (size_t i = 0; i != count; ++i) {
+			bool good = parse_field(src[i].begin(), src[i].end(), dst[i]);
+			if (!good) {
+				dst[i] = invalid;
+				++failed;
+			}
+			if (errors != nullptr)
+				errors[i] = good ? 0 : 1;
+		}
+		return failed;
+	}
+
+	template <typename T>
+	size_t from_chars_column(const StringViewRange *src, size_t count, T *dst, T invalid, uint8_t *errors, size_t threads)
+	{
+		threads = std::max<size_t>(1, std::min<size_t>(threads, count / column_grain));
+		if (threads == 1)
+			return parse_column(src, count, dst, invalid, errors);
+
+		std::vector<size_t> failed(threads);
+		auto task = [&](size_t i) {
+			size_t begin = count / threads * i;
+			size_t end = i + 1 == threads ? count : count / threads * (i + 1);
+			failed[i] = parse_column(src + begin, end - begin, dst + begin, invalid, errors == nullptr ? nullptr : errors + begin);
+		};
+		std::vector<std::thread> pool;
+		for (size_t i = 1; i < threads; ++i)
+			pool.emplace_back(task, i);
+		task(0);
+		for (auto &t : pool)
+			t.join();
+
+		size_t total = 0;
+		for (size_t n : failed)
+			total += n;
+		return total;
+	}
+
+	template size_t from_chars_column<signed char>(const StringViewRange*, size_t, signed char*, signed char, uint8_t*, size_t);
+	template size_t from_chars_column<unsigned char>(const StringViewRange*, size_t, unsigned char*, unsigned char, uint8_t*, size_t);
+	template size_t from_chars_column<short>(const StringViewRange*, size_t, short*, short, uint8_t*, size_t);
+	template size_t from_chars_column<unsigned short>(const StringViewRange*, size_t, unsigned short*, unsigned short, uint8_t*, size_t);
+	template size_t from_chars_column<int>(const StringViewRange*, size_t, int*, int, uint8_t*, size_t);
+	template size_t from_chars_column<unsigned>(const StringViewRange*, size_t, unsigned*, unsigned, uint8_t*, size_t);
+	template size_t from_chars_column<long>(const StringViewRange*, size_t, long*, long, uint8_t*, size_t);
+	template size_t from_chars_column<unsigned long>(const StringViewRange*, size_t, unsigned long*, unsigned long, uint8_t*, size_t);
+	template size_t from_chars_column<long long>(const StringViewRange*, size_t, long long*, long long, uint8_t*, size_t);
+	template size_t from_chars_column<unsigned long long>(const StringViewRange*, size_t, unsigned long long*, unsigned long long, uint8_t*, size_t);
+	template size_t from_chars_column<float>(const StringViewRange*, size_t, float*, float, uint8_t*, size_t);
+	template size_t from_chars_column<double>(const StringViewRange*, size_t, double*, double, uint8_t*, size_t);
+}
+PRILIB_END
@@ -0,0 +1,307 @@
+#include "convert.h"
+#include <cstring>
+
+#if (PRILIB_ARCH == PRILIB_ARCH_x64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#	include <emmintrin.h>
+#	define PRILIB_HEX_SSE2 1
+#	if (PRILIB_COMPILER == PRILIB_COMPILER_GCC) || (PRILIB_COMPILER == PRILIB_COMPILER_CLANG)
+#		include <immintrin.h>
+#		include <cpuid.h>
+#		define PRILIB_HEX_AVX2 1
+#		define PRILIB_HEX_TARGET_AVX2 __attribute__((target("avx2")))
+#	elif (PRILIB_COMPILER == PRILIB_COMPILER_MSVC)
+#		include <immintrin.h>
+#		include <intrin.h>
+#		define PRILIB_HEX_AVX2 1
+#		define PRILIB_HEX_TARGET_AVX2
+#	endif
+#endif
+
+PRILIB_BEGIN
+namespace Convert
+{
+	//========================
+	// * Scalar
+	//========================
+
+	static const char hex_digits[] = "0123456789ABCDEF";
+
+	// 0x00-0x0f for hex digits of either case, 0xff otherwise.
+	struct HexTable
+	{
+		uint8_t data[0x100];
+
+		HexTable() {
+			std::memset(data, 0xff, sizeof(data));
+			for (int i = 0; i != 10; ++i)
+				data['0' + i] = static_cast<uint8_t>(i);
+			for (int i = 0; i != 6; ++i)
+				data['a' + i] = data['A' + i] = static_cast<uint8_t>(10 + i);
+		}
+	};
+	static const HexTable hex_table;
+
+	static char* encode_scalar(const uint8_t *src, size_t size, char *dst, char separator)
+	{
+		for (size_t i = 0; i != size; ++i) {
+			dst[0] = hex_digits[src[i] >> 4];
+			dst[1] = hex_digits[src[i] & 0xf];
+			dst += 2;
+			if (separator != '\0' && i + 1 != size)
+				*dst++ = separator;
+		}
+		return dst;
+	}
+
+	static bool decode_scalar(const char *src, size_t count, uint8_t *dst)
+	{
+		for (size_t i = 0; i != count; ++i) {
+			uint8_t h = hex_table.data[static_cast<uint8_t>(src[2 * i])];
+			uint8_t l = hex_table.data[static_cast<uint8_t>(src[2 * i + 1])];
+			if ((h | l) & 0xf0)
+				return false;
+			dst[i] = static_cast<uint8_t>((h << 4) | l);
+		}
+		return true;
+	}
+
+	//========================
+	// * SSE2
+	//========================
+
+#if defined(PRILIB_HEX_SSE2)
+	// Nibbles (0-15) to '0'-'9' 'A'-'F'.
+	static __m128i nibble_to_ascii(__m128i n)
+	{
+		__m128i letter = _mm_cmpgt_epi8(n, _mm_set1_epi8(9));
+		return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')), _mm_and_si128(letter, _mm_set1_epi8('A' - '0' - 10)));
+	}
+
+	// The 32 chars of 16 bytes, in two registers.
+	static void encode_16(const uint8_t *src, __m128i &first, __m128i &second)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		__m128i mask = _mm_set1_epi8(0x0f);
+		__m128i hi = nibble_to_ascii(_mm_and_si128(_mm_srli_epi16(v, 4), mask));
+		__m128i lo = nibble_to_ascii(_mm_and_si128(v, mask));
+		first = _mm_unpacklo_epi8(hi, lo);
+		second = _mm_unpackhi_epi8(hi, lo);
+	}
+
+	// Chars to nibbles, 'valid' gets 0xff for hex digits.
+	static __m128i ascii_to_nibble(__m128i c, __m128i &valid)
+	{
+		__m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+		__m128i letter = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+		// Unsigned x <= n as min(x, n) == x.
+		__m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+		__m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+		valid = _mm_or_si128(is_digit, is_letter);
+		return _mm_or_si128(_mm_and_si128(is_digit, digit), _mm_and_si128(is_letter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+	}
+
+	// 16 bit lanes 'h | l << 8' to 'h << 4 | l'.
+	static __m128i combine_pairs(__m128i n)
+	{
+		__m128i h = _mm_and_si128(n, _mm_set1_epi16(0xff));
+		__m128i l = _mm_srli_epi16(n, 8);
+		return _mm_or_si128(_mm_slli_epi16(h, 4), l);
+	}
+
+	static char* encode_sse2(const uint8_t *src, size_t size, char *dst, char separator)
+	{
+		size_t i = 0;
+		if (separator == '\0') {
+			for (; i + 16 <= size; i += 16, dst += 32) {
+				__m128i a, b;
+				encode_16(src + i, a, b);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), a);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), b);
+			}
+		}
+		else {
+			// The separator after the block is written too : only while bytes follow.
+			alignas(16) char pairs[32];
+			for (; i + 16 < size; i += 16, dst += 48) {
+				__m128i a, b;
+				encode_16(src + i, a, b);
+				_mm_store_si128(reinterpret_cast<__m128i*>(pairs), a);
+				_mm_store_si128(reinterpret_cast<__m128i*>(pairs + 16), b);
+				for (int k = 0; k != 16; ++k) {
+					dst[3 * k] = pairs[2 * k];
+					dst[3 * k + 1] = pairs[2 * k + 1];
+					dst[3 * k + 2] = separator;
+				}
+			}
+		}
+		return encode_scalar(src + i, size - i, dst, separator);
+	}
+
+	static bool decode_sse2(const char *src, size_t count, uint8_t *dst)
+	{
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			__m128i va, vb;
+			__m128i a = ascii_to_nibble(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i)), va);
+			__m128i b = ascii_to_nibble(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i + 16)), vb);
+			if (_mm_movemask_epi8(_mm_and_si128(va, vb)) != 0xffff)
+				return false;
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(combine_pairs(a), combine_pairs(b)));
+		}
+		return decode_scalar(src + 2 * i, count - i, dst + i);
+	}
+#endif
+
+	//========================
+	// * AVX2
+	//========================
+
+#if defined(PRILIB_HEX_AVX2)
+	static bool has_avx2()
+	{
+#	if (PRILIB_COMPILER == PRILIB_COMPILER_MSVC)
+		int info[4];
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		if (!osxsave || (_xgetbv(0) & 6) != 6)
+			return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#	else
+		return __builtin_cpu_supports("avx2");
+#	endif
+	}
+
+	// pshufb masks spreading 32 chars (two registers) into 16 "XY " groups (three registers).
+	struct SpreadTable
+	{
+		alignas(16) int8_t first[3][16];
+		alignas(16) int8_t second[3][16];
+		alignas(16) int8_t separator[3][16];
+
+		SpreadTable() {
+			for (int k = 0; k != 48; ++k) {
+				int r = k / 16, j = k % 16;
+				int c = (k / 3) * 2 + k % 3;  // the char index
+				bool sep = k % 3 == 2;
+				first[r][j] = (!sep && c < 16) ? static_cast<int8_t>(c) : -1;
+				second[r][j] = (!sep && c >= 16) ? static_cast<int8_t>(c - 16) : -1;
+				separator[r][j] = sep ? -1 : 0;
+			}
+		}
+	};
+	static const SpreadTable spread_table;
+
+	PRILIB_HEX_TARGET_AVX2
+	static __m256i nibble_to_ascii_256(__m256i n)
+	{
+		__m256i letter = _mm256_cmpgt_epi8(n, _mm256_set1_epi8(9));
+		return _mm256_add_epi8(_mm256_add_epi8(n, _mm256_set1_epi8('0')), _mm256_and_si256(letter, _mm256_set1_epi8('A' - '0' - 10)));
+	}
+
+	PRILIB_HEX_TARGET_AVX2
+	static char* encode_avx2(const uint8_t *src, size_t size, char *dst, char separator)
+	{
+		size_t i = 0;
+		__m256i mask = _mm256_set1_epi8(0x0f);
+		if (separator == '\0') {
+			for (; i + 32 <= size; i += 32, dst += 64) {
+				__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+				__m256i hi = nibble_to_ascii_256(_mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+				__m256i lo = nibble_to_ascii_256(_mm256_and_si256(v, mask));
+				// Unpacking works in 128 bit lanes.
+				__m256i a = _mm256_unpacklo_epi8(hi, lo);
+				__m256i b = _mm256_unpackhi_epi8(hi, lo);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_permute2x128_si256(a, b, 0x20));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 32), _mm256_permute2x128_si256(a, b, 0x31));
+			}
+		}
+		else {
+			__m128i sep = _mm_set1_epi8(separator);
+			for (; i + 16 < size; i += 16, dst += 48) {
+				__m128i a, b;
+				encode_16(src + i, a, b);
+				for (int r = 0; r != 3; ++r) {
+					__m128i out = _mm_or_si128(
+						_mm_shuffle_epi8(a, _mm_load_si128(reinterpret_cast<const __m128i*>(spread_table.first[r]))),
+						_mm_shuffle_epi8(b, _mm_load_si128(reinterpret_cast<const __m128i*>(spread_table.second[r]))));
+					out = _mm_or_si128(out, _mm_and_si128(sep, _mm_load_si128(reinterpret_cast<const __m128i*>(spread_table.separator[r]))));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16 * r), out);
+				}
+			}
+		}
+		return encode_sse2(src + i, size - i, dst, separator);
+	}
+
+	PRILIB_HEX_TARGET_AVX2
+	static bool decode_avx2(const char *src, size_t count, uint8_t *dst)
+	{
+		size_t i = 0;
+		for (; i + 32 <= count; i += 32) {
+			__m256i nibbles[2];
+			__m256i valid = _mm256_set1_epi8(-1);
+			for (int h = 0; h != 2; ++h) {
+				__m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i + 32 * h));
+				__m256i digit = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+				__m256i letter = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+				__m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+				__m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+				valid = _mm256_and_si256(valid, _mm256_or_si256(is_digit, is_letter));
+				__m256i n = _mm256_or_si256(_mm256_and_si256(is_digit, digit), _mm256_and_si256(is_letter, _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+				nibbles[h] = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(n, _mm256_set1_epi16(0xff)), 4), _mm256_srli_epi16(n, 8));
+			}
+			if (_mm256_movemask_epi8(valid) != -1)
+				return false;
+			// Packing works in 128 bit lanes : put the quarters back in order.
+			__m256i packed = _mm256_packus_epi16(nibbles[0], nibbles[1]);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(packed, 0xd8));
+		}
+		return decode_sse2(src + 2 * i, count - i, dst + i);
+	}
+#endif
+
+	//========================
+	// * Dispatch
+	//========================
+
+	using EncodeFunc = char* (*)(const uint8_t*, size_t, char*, char);
+	using DecodeFunc = bool (*)(const char*, size_t, uint8_t*);
+
+	struct HexFuncs
+	{
+		EncodeFunc encode = encode_scalar;
+		DecodeFunc decode = decode_scalar;
+
+		HexFuncs() {
+#if defined(PRILIB_HEX_SSE2)
+			encode = encode_sse2;
+			decode = decode_sse2;
+#endif
+#if defined(PRILIB_HEX_AVX2)
+			if (has_avx2()) {
+				encode = encode_avx2;
+				decode = decode_avx2;
+			}
+#endif
+		}
+	};
+
+	static const HexFuncs& hex_funcs()
+	{
+		static const HexFuncs funcs;
+		return funcs;
+	}
+
+	char* hex_encode(const void *src, size_t size, char *dst, char separator)
+	{
+		return hex_funcs().encode(static_cast<const uint8_t*>(src), size, dst, separator);
+	}
+
+	bool hex_decode(const char *src, size_t length, void *dst)
+	{
+		if (length % 2 != 0)
+			return false;
+		return hex_funcs().decode(src, length / 2, static_cast<uint8_t*>(dst));
+	}
+}
+PRILIB_END
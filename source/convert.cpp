@@ -1,35 +1,23 @@
 #include "convert.h"
 #include "charptr.h"
 #include "record.h"
-#include "range.h"
 #include <algorithm>
 #include <cerrno>
 
+#if (PRILIB_ARCH == PRILIB_ARCH_x64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#	include <emmintrin.h>
+#	define PRILIB_CONVERT_SSE2 1
+#endif
+
 PRILIB_BEGIN
 namespace Convert
 {
 	std::string to_hex(const void *src, size_t size)
 	{
-		charptr result(3 * size + 10);
-
-		const byte *begin = reinterpret_cast<const byte*>(src);
-		const byte *end = begin + size;
-		char *rp = result;
-
-		for (auto ptr : range(begin, end)) {
-			int v;
-			v = *ptr / 0x10;
-			rp[0] = (v < 10) ? ('0' + v) : ('A' + v - 10);
-			v = *ptr % 0x10;
-			rp[1] = (v < 10) ? ('0' + v) : ('A' + v - 10);
-			rp[2] = ' ';
-			rp += 3;
-		}
-
-		if (size > 0)
-			rp[-1] = '\0';
-
-		return result.to_string();
+		std::string result(hex_size(size), '\0');
+		if (size != 0)
+			hex_encode(src, size, &result[0]);
+		return result;
 	}
 }
 
@@ -55,13 +43,27 @@ namespace Convert
 		return true;
 	}
 
+	// from_chars takes what strtoll takes the same way, but for a signed zero ("+0", "-0"),
+	// which strtoll does not.
+	template <typename T>
+	static bool to_num_fast(const std::string &str, T &result, int base)
+	{
+		T value;
+		if (base == 0 || !from_chars(str.data(), str.data() + str.size(), value, base))
+			return false;
+		if (value == 0 && str[0] != '0')
+			return false;
+		result = value;
+		return true;
+	}
+
 	bool to_ll(const std::string &str, long long &result, int base)
 	{
-		return to_num_base<long long, std::strtoll>(str, result, base);
+		return to_num_fast(str, result, base) || to_num_base<long long, std::strtoll>(str, result, base);
 	}
 	bool to_ull(const std::string &str, unsigned long long &result, int base)
 	{
-		return to_num_base<unsigned long long, std::strtoull>(str, result, base);
+		return to_num_fast(str, result, base) || to_num_base<unsigned long long, std::strtoull>(str, result, base);
 	}
 
 	static int to_integer(char c);
@@ -103,15 +105,6 @@ namespace Convert
 		return false;
 	}
 
-	static bool to_base16(char higher, char lower, uint8_t &result) {
-		uint8_t v1, v2;
-		if (to_integer(higher, v1, 16) && to_integer(lower, v2, 16)) {
-			result = v1 * 0x10 + v2;
-			return true;
-		}
-		return false;
-	}
-
 	bool to_base16(const std::string &str, void *dst, size_t size, size_t msize) {
 		if (str.empty())
 			return false;
@@ -126,58 +119,64 @@ namespace Convert
 		if (!islsb && (size > msize))
 			size = msize;
 
-		size_t i;
-		for (i = 0; i < std::min(strsize / 2, size); ++i) {
-			auto &d = reinterpret_cast<uint8_t*>(dst)[islsb ? i : (msize - i - 1)];
-			size_t si = strsize - i * 2 - 2;
-			char higher = str[si];
-			char lower = str[si + 1];
-			if (!to_base16(higher, lower, d))
+		// The last 'count' pairs, decoded in text order then put in place.
+		uint8_t *bytes = reinterpret_cast<uint8_t*>(dst);
+		const size_t count = std::min(strsize / 2, size);
+		if (islsb) {
+			if (!hex_decode(str.data() + strsize - count * 2, count * 2, bytes))
+				return false;
+			std::reverse(bytes, bytes + count);
+		}
+		else {
+			if (!hex_decode(str.data() + strsize - count * 2, count * 2, bytes + msize - count))
 				return false;
 		}
 
+		const size_t i = count;
 		if ((isresize || (!isresize && size > strsize / 2)) && (strsize % 2 != 0 && (islsb || (!islsb && msize > i)))) {
-			if (!to_integer(str[0], reinterpret_cast<uint8_t*>(dst)[islsb ? i : (msize - i - 1)], 16))
+			if (!to_integer(str[0], bytes[islsb ? i : (msize - i - 1)], 16))
 				return false;
 		}
 		return true;
 	}
 }
 
-void Convert::split(const std::string &token, const std::string &delimit, std::function<void(const char *)> yield, bool remain, bool lastremain)
+const char* Convert::Delimiter::_find(const char *p, const char *last) const
 {
-	charptr buffer(token + (lastremain ? "," : ""));
-	if (remain) {
-		char *p = buffer.get();
-		char *saveptr = p;
-
-		while (*p) {
-			if (delimit.find(*p) != delimit.npos) {
-				*p = '\0';
-				yield(saveptr);
-				saveptr = p + 1;
+#if defined(PRILIB_CONVERT_SSE2)
+	if (_count <= sizeof(_chars)) {
+		__m128i sets[sizeof(_chars)];
+		for (size_t i = 0; i != _count; ++i)
+			sets[i] = _mm_set1_epi8(_chars[i]);
+		for (; last - p >= 16; p += 16) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			__m128i hit = _mm_setzero_si128();
+			for (size_t i = 0; i != _count; ++i)
+				hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, sets[i]));
+			unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+			if (mask != 0) {
+				while ((mask & 1) == 0) {
+					mask >>= 1;
+					++p;
+				}
+				return p;
 			}
-			p++;
-		}
-		if (saveptr != p) {
-			yield(saveptr);
 		}
 	}
-	else {
-#if (defined(_MSC_VER))
-		auto _strtok = strtok_s;
-#else
-		auto _strtok = strtok_r;
 #endif
-		char *saveptr;
-		char *p;
-		charptr buffer(token);
-
-		p = _strtok(buffer, delimit.c_str(), &saveptr);
-		while (p) {
-			yield(p);
-			p = _strtok(nullptr, delimit.c_str(), &saveptr);
-		}
-	}
+	while (p != last && !contains(*p))
+		++p;
+	return p;
+}
+
+void Convert::split(const std::string &token, const std::string &delimit, std::function<void(const char *)> yield, bool remain, bool lastremain)
+{
+	// One copy, terminated at each delimiter in place.
+	std::string buffer(token.c_str());
+	char *data = &buffer[0];
+	split(buffer.data(), buffer.data() + buffer.size(), Delimiter(delimit), [&](const StringViewRange &field) {
+		data[field.end() - buffer.data()] = '\0';
+		yield(field.begin());
+	}, remain, lastremain);
 }
 PRILIB_END
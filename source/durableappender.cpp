@@ -0,0 +1,147 @@
+#include "durableappender.h"
+#include <algorithm>
+#include <cerrno>
+
+#if (PRILIB_OS == PRILIB_OS_WINDOWS)
+#	include <io.h>
+#	include <fcntl.h>
+#	include <sys/stat.h>
+#else
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
+PRILIB_BEGIN
+//========================
+// * Platform
+//========================
+
+static int open_append(const std::string &filename)
+{
+#if (PRILIB_OS == PRILIB_OS_WINDOWS)
+	int fd = -1;
+	_sopen_s(&fd, filename.c_str(), _O_WRONLY | _O_APPEND | _O_CREAT | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+	return fd;
+#else
+	return ::open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+#endif
+}
+
+static bool write_all(int fd, const char *data, size_t size)
+{
+	while (size != 0) {
+#if (PRILIB_OS == PRILIB_OS_WINDOWS)
+		int n = _write(fd, data, static_cast<unsigned>(std::min<size_t>(size, 0x40000000)));
+#else
+		ssize_t n = ::write(fd, data, size);
+#endif
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		data += n;
+		size -= static_cast<size_t>(n);
+	}
+	return true;
+}
+
+static bool sync_data(int fd)
+{
+#if (PRILIB_OS == PRILIB_OS_WINDOWS)
+	return _commit(fd) == 0;
+#elif (PRILIB_OS == PRILIB_OS_LINUX)
+	return fdatasync(fd) == 0;
+#else
+	return fsync(fd) == 0;
+#endif
+}
+
+static void close_fd(int fd)
+{
+#if (PRILIB_OS == PRILIB_OS_WINDOWS)
+	_close(fd);
+#else
+	::close(fd);
+#endif
+}
+
+//========================
+// * DurableAppender
+//========================
+
+DurableAppender::DurableAppender(const std::string &filename, size_t capacity)
+	: _capacity(capacity ? capacity : 1) {
+	_fd = open_append(filename);
+	if (_fd != -1)
+		_thread = std::thread(&DurableAppender::_run, this);
+}
+
+DurableAppender::~DurableAppender() {
+	if (_fd == -1)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_work.notify_one();
+	_thread.join();
+	close_fd(_fd);
+}
+
+DurableAppender::Ticket DurableAppender::submit(const void *data, size_t size) {
+	if (_fd == -1)
+		return 0;
+	std::unique_lock<std::mutex> lock(_mutex);
+	// A record larger than 'capacity' still goes alone into an empty queue.
+	_done.wait(lock, [&] { return _failed || _pending.empty() || _pending.size() + size <= _capacity; });
+	if (_failed)
+		return 0;
+	bool idle = _pending.empty();
+	_pending.append(static_cast<const char*>(data), size);
+	Ticket ticket = ++_submitted;
+	lock.unlock();
+	if (idle)
+		_work.notify_one();
+	return ticket;
+}
+
+bool DurableAppender::wait(Ticket ticket) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_done.wait(lock, [&] { return _durable >= ticket || _failed; });
+	return _durable >= ticket;
+}
+
+uint64_t DurableAppender::commits() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _commits;
+}
+
+bool DurableAppender::_commit(const std::string &batch) {
+	return write_all(_fd, batch.data(), batch.size()) && sync_data(_fd);
+}
+
+void DurableAppender::_run() {
+	std::string batch;
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (;;) {
+		_work.wait(lock, [&] { return _stop || !_pending.empty(); });
+		if (_pending.empty())
+			break;
+		// Records submitted while this batch is written gather for the next one.
+		batch.swap(_pending);
+		Ticket last = _submitted;
+		lock.unlock();
+		bool ok = _commit(batch);
+		batch.clear();
+		lock.lock();
+		++_commits;
+		if (ok)
+			_durable = last;
+		else
+			_failed = true;
+		_done.notify_all();
+		if (_failed)
+			break;
+	}
+}
+PRILIB_END
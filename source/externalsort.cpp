@@ -0,0 +1,442 @@
+#include "externalsort.h"
+#include "varint.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cassert>
+
+PRILIB_BEGIN
+//========================
+// * Run format
+//========================
+//  row   : varint(count) field...
+//  field : varint(length) bytes
+
+static void write_varint(std::string &buffer, uint64_t value)
+{
+	byte data[Varint::max_size];
+	buffer.append(reinterpret_cast<const char*>(data), Varint::encode(value, data));
+}
+
+static bool read_varint(FILE *file, uint64_t &value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		int c = std::getc(file);
+		if (c == EOF || (shift == 63 && c > 1))
+			return false;
+		value |= static_cast<uint64_t>(c & 0x7f) << shift;
+		if ((c & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+static void write_row(std::string &buffer, const ExternalSort::Row &row)
+{
+	write_varint(buffer, row.size());
+	for (auto &field : row) {
+		write_varint(buffer, field.size());
+		buffer.append(field);
+	}
+}
+
+static bool read_row(BinaryFile &file, ExternalSort::Row &row)
+{
+	uint64_t count;
+	if (!read_varint(file, count))
+		return false;
+	row.resize(static_cast<size_t>(count));
+	for (auto &field : row) {
+		uint64_t length;
+		if (!read_varint(file, length))
+			return false;
+		field.resize(static_cast<size_t>(length));
+		if (length != 0 && !file.read(&field[0], field.size()))
+			return false;
+	}
+	return true;
+}
+
+// A temporary file taking rows, through a buffer.
+class RunWriter
+{
+public:
+	RunWriter() {
+		FILE *fp = std::tmpfile();
+		if (fp != nullptr)
+			_run = BinaryFile(fp, true);
+		_good = fp != nullptr;
+	}
+
+	void write(const ExternalSort::Row &row) {
+		write_row(_buffer, row);
+		if (_buffer.size() >= 0x10000)
+			_flush();
+	}
+
+	// The run rewound for reading, or a bad file if any write failed.
+	BinaryFile finish() {
+		_flush();
+		if (!_good || std::fflush(_run) != 0)
+			return BinaryFile();
+		std::rewind(_run);
+		return _run;
+	}
+
+private:
+	BinaryFile _run;
+	std::string _buffer;
+	bool _good;
+
+	void _flush() {
+		if (_good && std::fwrite(_buffer.data(), sizeof(char), _buffer.size(), _run) != _buffer.size())
+			_good = false;
+		_buffer.clear();
+	}
+};
+
+static BinaryFile spill_run(std::vector<ExternalSort::Row> chunk, const ExternalSort::Compare &comp)
+{
+	std::stable_sort(chunk.begin(), chunk.end(), comp);
+
+	RunWriter writer;
+	for (auto &row : chunk)
+		writer.write(row);
+	return writer.finish();
+}
+
+//========================
+// * LoserTree
+//========================
+
+// tree[0] : the winner, tree[1..k) : the losers of each match.
+// Leaf k is a virtual minimum, only used while building.
+class LoserTree
+{
+public:
+	using Row = ExternalSort::Row;
+
+	LoserTree(std::vector<BinaryFile> &runs, const ExternalSort::Compare &comp)
+		: _runs(runs), _comp(comp), _k(runs.size()), _rows(_k), _alive(_k), _tree(_k, _k) {
+		for (size_t i = 0; i != _k; ++i)
+			_alive[i] = read_row(_runs[i], _rows[i]);
+		for (size_t i = _k; i-- != 0; )
+			_adjust(i);
+	}
+
+	bool empty() const {
+		return !_alive[_tree[0]];
+	}
+	const Row& top() const {
+		return _rows[_tree[0]];
+	}
+	void pop() {
+		size_t s = _tree[0];
+		_alive[s] = read_row(_runs[s], _rows[s]);
+		_adjust(s);
+	}
+
+private:
+	std::vector<BinaryFile> &_runs;
+	const ExternalSort::Compare &_comp;
+	size_t _k;
+	std::vector<Row> _rows;
+	std::vector<bool> _alive;
+	std::vector<size_t> _tree;
+
+	// Whether a wins over b, run order breaks ties.
+	bool _less(size_t a, size_t b) const {
+		if (a == _k)
+			return true;
+		if (b == _k)
+			return false;
+		if (!_alive[a])
+			return false;
+		if (!_alive[b])
+			return true;
+		if (_comp(_rows[a], _rows[b]))
+			return true;
+		if (_comp(_rows[b], _rows[a]))
+			return false;
+		return a < b;
+	}
+
+	void _adjust(size_t s) {
+		for (size_t t = (s + _k) / 2; t > 0; t /= 2) {
+			if (_less(_tree[t], s))
+				std::swap(s, _tree[t]);
+		}
+		_tree[0] = s;
+	}
+};
+
+// Whether every run was read to its end, not stopped by an error.
+static bool read_whole(const std::vector<BinaryFile> &runs)
+{
+	for (auto &run : runs) {
+		if (std::ferror(run))
+			return false;
+	}
+	return true;
+}
+
+// Merge runs (in order, for stability) into one run.
+static BinaryFile merge_runs(std::vector<BinaryFile> runs, const ExternalSort::Compare &comp)
+{
+	RunWriter writer;
+	LoserTree tree(runs, comp);
+	while (!tree.empty()) {
+		writer.write(tree.top());
+		tree.pop();
+	}
+	if (!read_whole(runs))
+		return BinaryFile();
+	return writer.finish();
+}
+
+//========================
+// * ExternalSort
+//========================
+
+ExternalSort::ExternalSort(Compare comp, const Options &options)
+	: _comp(comp), _options(options) {
+	if (_options.threads == 0)
+		_options.threads = 1;
+	if (_options.fanin < 2)
+		_options.fanin = 2;
+}
+
+ExternalSort::ExternalSort(const std::vector<size_t> &keys, const Options &options)
+	: ExternalSort([keys](const Row &a, const Row &b) {
+		static const std::string empty;
+		for (size_t key : keys) {
+			const std::string &x = key <= a.size() ? a[key - 1] : empty;
+			const std::string &y = key <= b.size() ? b[key - 1] : empty;
+			int c = x.compare(y);
+			if (c != 0)
+				return c < 0;
+		}
+		return false;
+	}, options) {}
+
+ExternalSort::~ExternalSort() {
+	_wait(0);
+}
+
+size_t ExternalSort::row_size(const Row &row) {
+	size_t size = sizeof(Row) + row.size() * sizeof(std::string);
+	for (auto &field : row)
+		size += field.size();
+	return size;
+}
+
+void ExternalSort::push(Row &&row) {
+	_chunksize += row_size(row);
+	_chunk.push_back(std::move(row));
+	// One chunk filling and one being sorted by each thread.
+	if (_chunksize >= _options.memory / (_options.threads + 1))
+		_spill();
+}
+
+void ExternalSort::load(TextFile &input) {
+	while (!input.eof()) {
+		auto line = input.getline_view();
+		if (line.empty())
+			continue;
+		Row row;
+		Convert::split(line, ',', [&](const StringViewRange &field) {
+			row.emplace_back(field.begin(), field.end());
+		}, true, true);
+		push(std::move(row));
+	}
+}
+
+bool ExternalSort::sort(Yield yield) {
+	bool result;
+	if (_runs.empty() && _pending.empty()) {
+		std::stable_sort(_chunk.begin(), _chunk.end(), _comp);
+		for (auto &row : _chunk)
+			yield(row);
+		result = _good;
+	}
+	else {
+		if (!_chunk.empty())
+			_spill();
+		_wait(0);
+		result = _good && _merge(yield);
+	}
+	_chunk.clear();
+	_chunksize = 0;
+	_runs.clear();
+	_levels.clear();
+	_good = true;
+	return result;
+}
+
+bool ExternalSort::save(TextFile &output) {
+	std::string line;
+	return sort([&](const Row &row) {
+		line.clear();
+		for (size_t i = 0; i != row.size(); ++i) {
+			if (i != 0)
+				line.push_back(',');
+			line.append(row[i]);
+		}
+		line.push_back('\n');
+		output.write(line);
+	});
+}
+
+void ExternalSort::_spill() {
+	_wait(_options.threads - 1);
+	_pending.push_back(std::async(std::launch::async, spill_run, std::move(_chunk), _comp));
+	_chunk = std::vector<Row>();
+	_chunksize = 0;
+}
+
+// Wait until at most 'pending' runs are being spilled.
+void ExternalSort::_wait(size_t pending) {
+	while (_pending.size() > pending) {
+		BinaryFile run = _pending.front().get();
+		_pending.pop_front();
+		if (run.bad()) {
+			_good = false;
+			continue;
+		}
+		_runs.push_back(run);
+		_levels.push_back(0);
+		_collapse();
+	}
+}
+
+// Runs are kept in levels, non-increasing from the first run :
+// 'fanin' runs of one level are merged into a run of the next level,
+// which keeps about 'fanin' runs open for each level.
+void ExternalSort::_collapse() {
+	const size_t fanin = _options.fanin;
+	while (_good && _runs.size() >= fanin && _levels[_runs.size() - fanin] == _levels.back()) {
+		const size_t first = _runs.size() - fanin;
+		const size_t level = _levels.back() + 1;
+		std::vector<BinaryFile> group(_runs.begin() + first, _runs.end());
+		_runs.resize(first);
+		_levels.resize(first);
+		BinaryFile run = merge_runs(std::move(group), _comp);
+		if (run.bad()) {
+			_good = false;
+			return;
+		}
+		_runs.push_back(run);
+		_levels.push_back(level);
+	}
+}
+
+bool ExternalSort::_merge(Yield yield) {
+	// Passes over consecutive groups, until one tree takes all runs.
+	while (_runs.size() > _options.fanin) {
+		std::vector<BinaryFile> runs;
+		for (size_t first = 0; first < _runs.size(); first += _options.fanin) {
+			size_t last = std::min(first + _options.fanin, _runs.size());
+			std::vector<BinaryFile> group(_runs.begin() + first, _runs.begin() + last);
+			std::fill(_runs.begin() + first, _runs.begin() + last, BinaryFile());
+			BinaryFile run = merge_runs(std::move(group), _comp);
+			if (run.bad())
+				return false;
+			runs.push_back(run);
+		}
+		_runs.swap(runs);
+	}
+
+	LoserTree tree(_runs, _comp);
+	while (!tree.empty()) {
+		yield(tree.top());
+		tree.pop();
+	}
+	return read_whole(_runs);
+}
+
+//========================
+// * GroupBy
+//========================
+
+static bool to_number(const std::string &str, double &result)
+{
+	return Convert::from_chars(str.data(), str.data() + str.size(), result);
+}
+
+GroupBy::GroupBy(const std::vector<size_t> &keys, const std::vector<Aggregate> &aggregates, Yield yield)
+	: _keys(keys), _aggregates(aggregates), _yield(yield), _states(aggregates.size()) {}
+
+void GroupBy::push(const Row &row) {
+	if (!_open || !_same(row)) {
+		if (_open)
+			_emit();
+		_reset(row);
+	}
+	for (size_t i = 0; i != _aggregates.size(); ++i) {
+		auto &aggregate = _aggregates[i];
+		auto &state = _states[i];
+		if (aggregate.function == Count) {
+			++state.count;
+			continue;
+		}
+		double value;
+		if (aggregate.column > row.size() || !to_number(row[aggregate.column - 1], value))
+			continue;
+		switch (aggregate.function) {
+		case Sum:
+		case Mean:
+			state.value = state.count == 0 ? value : state.value + value; break;
+		case Min:
+			state.value = state.count == 0 ? value : std::min(state.value, value); break;
+		case Max:
+			state.value = state.count == 0 ? value : std::max(state.value, value); break;
+		default:
+			break;
+		}
+		++state.count;
+	}
+}
+
+void GroupBy::finish() {
+	if (_open)
+		_emit();
+	_open = false;
+}
+
+bool GroupBy::_same(const Row &row) const {
+	static const std::string empty;
+	for (size_t i = 0; i != _keys.size(); ++i) {
+		size_t key = _keys[i];
+		const std::string &field = key <= row.size() ? row[key - 1] : empty;
+		if (field != _current[i])
+			return false;
+	}
+	return true;
+}
+
+void GroupBy::_reset(const Row &row) {
+	_current.clear();
+	for (size_t key : _keys)
+		_current.push_back(key <= row.size() ? row[key - 1] : std::string());
+	std::fill(_states.begin(), _states.end(), State { 0, 0 });
+	_open = true;
+}
+
+void GroupBy::_emit() {
+	Row result = _current;
+	for (size_t i = 0; i != _aggregates.size(); ++i) {
+		auto &state = _states[i];
+		switch (_aggregates[i].function) {
+		case Count:
+			result.push_back(Convert::to_string(state.count)); break;
+		case Mean:
+			result.push_back(state.count == 0 ? std::string() : Convert::to_string(state.value / state.count)); break;
+		default:
+			result.push_back(state.count == 0 ? std::string() : Convert::to_string(state.value)); break;
+		}
+	}
+	_yield(result);
+}
+PRILIB_END
@@ -1,8 +1,25 @@
 #include "file.h"
 #include "charptr.h"
-#include <list>
+#include "lineindex.h"
 #include <algorithm>
 #include <cassert>
+#include <climits>
+#include <cstring>
+#include <cerrno>
+
+#if (PRILIB_OS == PRILIB_OS_WINDOWS)
+#	include <Windows.h>
+#	include <io.h>
+#	include <sys/stat.h>
+#else
+#	include <unistd.h>
+#	include <sys/stat.h>
+#endif
+
+#if (PRILIB_OS == PRILIB_OS_LINUX)
+#	include <sys/sendfile.h>
+#	include <sys/syscall.h>
+#endif
 
 PRILIB_BEGIN
 #ifdef _MSC_VER
@@ -42,13 +59,116 @@ File::File(FILE *fp, bool exclusive) {
 	}
 }
 
-size_t File::size() const {
+File::SizeType File::size() const {
+	if (!_sizeSet)
+		_setSize();
 	return _size;
 }
+bool File::sized() const {
+	if (!_sizeSet)
+		_setSize();
+	return _sized;
+}
 bool File::eof() const {
 	assert(!bad());
 	return feof(_file.get()) != 0;
 }
+bool File::flush() {
+	assert(!bad());
+	return fflush(_file.get()) == 0;
+}
+
+File::OffsetType File::tell() const {
+	assert(!bad());
+#if defined(_MSC_VER)
+	return _ftelli64(_file.get());
+#else
+	return static_cast<OffsetType>(ftello(_file.get()));
+#endif
+}
+bool File::seek(OffsetType offset, int origin) {
+	assert(!bad());
+#if defined(_MSC_VER)
+	return _fseeki64(_file.get(), offset, origin) == 0;
+#else
+	return fseeko(_file.get(), static_cast<off_t>(offset), origin) == 0;
+#endif
+}
+
+#if (PRILIB_OS == PRILIB_OS_LINUX)
+static ssize_t copy_range(int in, off_t *offset, int out, size_t length)
+{
+#	if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+	return ::copy_file_range(in, offset, out, nullptr, length, 0);
+#	elif defined(SYS_copy_file_range)
+	return ::syscall(SYS_copy_file_range, in, offset, out, nullptr, length, 0);
+#	else
+	errno = ENOSYS;
+	return -1;
+#	endif
+}
+
+// Copy in the kernel, from 'offset' of 'in' to the position of 'out'.
+// Stop at the first error : the rest is left to the buffered copy.
+static File::SizeType kernel_copy(int in, File::SizeType offset, int out, File::SizeType length)
+{
+	enum { CopyRange, SendFile } method = CopyRange;
+	off_t pos = static_cast<off_t>(offset);
+	File::SizeType count = 0;
+	while (count < length) {
+		size_t step = static_cast<size_t>(std::min<File::SizeType>(length - count, 0x40000000));
+		ssize_t n = (method == CopyRange) ? copy_range(in, &pos, out, step) : ::sendfile(out, in, &pos, step);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && method == CopyRange) {
+			// Other file systems, pipes, append mode, old kernels.
+			method = SendFile;
+			continue;
+		}
+		if (n <= 0)
+			break;
+		count += static_cast<File::SizeType>(n);
+	}
+	return count;
+}
+#endif
+
+File::SizeType File::copy_to(File &dst, SizeType offset, SizeType length) const {
+	assert(!bad() && !dst.bad());
+	fflush(_file.get());
+	dst.flush();
+	// Taken again : the file may have been written since it was opened.
+	// Without a size (pipes), copy until the end of file.
+	_setSize();
+	if (_sized)
+		length = offset < _size ? std::min(length, _size - offset) : 0;
+
+	SizeType count = 0;
+#if (PRILIB_OS == PRILIB_OS_LINUX)
+	int out = fileno(dst.c_ptr());
+	count = kernel_copy(fileno(_file.get()), offset, out, length);
+	if (count != 0) {
+		// The descriptor has moved, move the stream to it.
+		off_t pos = ::lseek(out, 0, SEEK_CUR);
+		if (pos >= 0)
+			dst.seek(static_cast<OffsetType>(pos));
+	}
+#endif
+
+	BinaryFile src(*this);
+	std::unique_ptr<char[]> buffer;
+	const size_t capacity = 0x10000;
+	while (count < length) {
+		if (!buffer)
+			buffer.reset(new char[capacity]);
+		size_t step = static_cast<size_t>(std::min<SizeType>(length - count, capacity));
+		size_t n = src.read_at(offset + count, buffer.get(), step);
+		if (n == 0 || fwrite(buffer.get(), 1, n, dst.c_ptr()) != n)
+			break;
+		count += n;
+	}
+	return count;
+}
 
 void File::_priOpen(const std::string &filename, TBMode tbmode, RWMode rwmode) {
 	char mode[4];
@@ -60,17 +180,22 @@ void File::_priOpen(const std::string &filename, TBMode tbmode, RWMode rwmode) {
 	}
 }
 
-void File::_setSize() {
-	long size;
-	if (bad()) {
-		size = 0;
-	}
-	else {
-		FileRecordPost frecpost(_file.get());
-		_setPostEnd();
-		size = ftell(_file.get());
+void File::_setSize() const {
+	_size = 0;
+	_sized = false;
+	_sizeSet = true;
+	if (bad())
+		return;
+#if (PRILIB_OS == PRILIB_OS_WINDOWS)
+	struct _stat64 st;
+	if (_fstat64(_fileno(_file.get()), &st) == 0 && (st.st_mode & _S_IFREG)) {
+#else
+	struct stat st;
+	if (fstat(fileno(_file.get()), &st) == 0 && S_ISREG(st.st_mode)) {
+#endif
+		_size = static_cast<SizeType>(st.st_size);
+		_sized = true;
 	}
-	this->_size = static_cast<size_t>(size);
 }
 
 inline void File::_setPostBegin() const {
@@ -113,61 +238,94 @@ void File::_getMode(char mode[4], TBMode tbmode, RWMode rwmode) {
 //========================
 
 std::string TextFile::getline() {
-	std::list<charptr> strlist;
-	const size_t size = 0x100;
-	size_t length = 0;
-
-	while (true) {
-		strlist.push_back(charptr(size));
-		charptr &buffer = strlist.back();
+	auto line = getline_view();
+	return std::string(line.begin(), line.end());
+}
 
-		fgets(buffer.get(), size + 1, _file.get());
+bool TextFile::getline(std::string &line) {
+	auto view = getline_view();
+	line.assign(view.begin(), view.end());
+	return !(view.size() == 0 && eof());
+}
 
-		// Line:
-		//  Linux:   \n
-		//  Windows: \r\n
+StringViewRange TextFile::getline_view() {
+	FILE *fp = _file.get();
+	size_t length = 0;
 
-		char c = buffer[size - 1];
-		if (c == '\0' || c == '\n') {
-			length += buffer.length();
-			break;
+#if PRILIB_OS_IS_UNIX(PRILIB_OS)
+	ssize_t n = ::getline(&_line.data, &_line.capacity, fp);
+	if (n > 0)
+		length = static_cast<size_t>(n);
+#else
+	while (true) {
+		if (_line.capacity < length + 0x100) {
+			size_t capacity = std::max<size_t>(_line.capacity * 2, length + 0x100);
+			char *data = static_cast<char*>(std::realloc(_line.data, capacity));
+			if (data == nullptr)
+				break;
+			_line.data = data;
+			_line.capacity = capacity;
 		}
-		else {
-			length += size;
+		char *p = _line.data + length;
+		size_t size = _line.capacity - length;
+		if (std::fgets(p, static_cast<int>(std::min<size_t>(size, INT_MAX)), fp) == nullptr)
+			break;
+		// Only what fgets stored : the bytes after its '\0' are from earlier lines.
+		size_t step = std::strlen(p);
+		auto end = static_cast<const char*>(std::memchr(p, '\n', step));
+		if (end != nullptr) {
+			length = end - _line.data + 1;
+			break;
 		}
+		length += step;
+		if (step != size - 1)
+			break;
 	}
+#endif
 
-	if (length == 0)
-		return "";
-
-	charptr result(length); // The std::string end without '\0'
-	size_t reclen = length;
-
-	auto iter = result.get();
-
-	for (auto &str : strlist) {
-		size_t step = reclen < size ? reclen : size;
-		std::memcpy(iter, str.get(), step);
-		iter += step;
-		reclen -= step;
+	// Line:
+	//  Linux:   \n
+	//  Windows: \r\n
+	if (length >= 1 && _line.data[length - 1] == '\n') {
+		--length;
+		if (length >= 1 && _line.data[length - 1] == '\r')
+			--length;
 	}
 
-	// Remove \n, \r
-	if (result[length - 1] == '\n')
-		result[length - 1] = '\0';
-	if (length >= 2 && result[length - 2] == '\r')
-		result[length - 2] = '\0';
+	return StringViewRange(length == 0 ? "" : _line.data, length);
+}
 
-	return result.get(); // Remove '\0
+bool TextFile::seek_line(uint64_t line, const LineIndex &index) {
+	if (bad() || line >= index.lines())
+		return false;
+	uint64_t skip;
+	if (!seek(static_cast<OffsetType>(index.offset(line, skip))))
+		return false;
+	while (skip-- != 0) {
+		getline_view();
+		if (eof())
+			return false;
+	}
+	return true;
 }
 
 std::string TextFile::getText() const {
 	if (bad()) return "";
+	std::string text;
+	if (!sized()) {
+		// Pipes : the rest of the stream.
+		char buffer[0x1000];
+		size_t n;
+		while ((n = fread(buffer, sizeof(char), sizeof(buffer), _file.get())) != 0)
+			text.append(buffer, n);
+		return text;
+	}
 	FileRecordPost frecpost(_file.get());
-	charptr tmp(size());
+	text.resize(static_cast<size_t>(size()));
 	_setPostBegin();
-	fread(tmp, sizeof(char), size(), _file.get());
-	return tmp.to_string();
+	if (!text.empty())
+		text.resize(fread(&text[0], sizeof(char), text.size(), _file.get()));
+	return text;
 }
 bool TextFile::getfmt(char *dst, size_t len) {
 #if defined(_MSC_VER)
@@ -201,4 +359,125 @@ bool BinaryFile::write(const void * buffer, size_t elsize, size_t elcount) {
 bool BinaryFile::read(void * buffer, size_t elsize, size_t elcount) {
 	return fread(buffer, elsize, elcount, _file.get()) != 0;
 }
+
+bool BinaryFile::read_string(std::string &result, char delimit) {
+	assert(!bad());
+	FILE *fp = _file.get();
+#if PRILIB_OS_IS_UNIX(PRILIB_OS)
+	// getdelim scans the stream buffer with memchr and copies in bulk.
+	ssize_t n = ::getdelim(&_line.data, &_line.capacity, static_cast<unsigned char>(delimit), fp);
+	if (n <= 0) {
+		result.clear();
+		return false;
+	}
+	size_t length = static_cast<size_t>(n);
+	if (_line.data[length - 1] == delimit)
+		--length;
+	result.assign(_line.data, length);
+	return true;
+#else
+	result.clear();
+	int c;
+	while ((c = _getc_nolock(fp)) != EOF) {
+		if (static_cast<char>(c) == delimit)
+			return true;
+		result.push_back(static_cast<char>(c));
+	}
+	return !result.empty();
+#endif
+}
+
+bool BinaryFile::write_sized_string(const std::string &str) {
+	uint32_t length = static_cast<uint32_t>(str.size());
+	assert(length == str.size());
+	return write(length) && (length == 0 || write(str.data(), length));
+}
+
+bool BinaryFile::read_sized_string(std::string &result) {
+	uint32_t length;
+	if (!read(length))
+		return false;
+	result.resize(length);
+	return length == 0 || fread(&result[0], 1, length, _file.get()) == length;
+}
+
+#if (PRILIB_OS == PRILIB_OS_WINDOWS)
+// With an OVERLAPPED offset, ReadFile/WriteFile are positional as well,
+// but they still move the handle position the CRT reads and writes at next :
+// it is saved before and put back after.
+static bool save_position(HANDLE handle, LARGE_INTEGER &position)
+{
+	LARGE_INTEGER zero = {};
+	return SetFilePointerEx(handle, zero, &position, FILE_CURRENT) != 0;
+}
+size_t BinaryFile::read_at(uint64_t offset, void *buffer, size_t size) const {
+	assert(!bad());
+	HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(_file.get())));
+	LARGE_INTEGER position;
+	bool saved = save_position(handle, position);
+	size_t count = 0;
+	while (count < size) {
+		OVERLAPPED ov = {};
+		ov.Offset = static_cast<DWORD>(offset + count);
+		ov.OffsetHigh = static_cast<DWORD>((offset + count) >> 32);
+		DWORD step = static_cast<DWORD>(std::min<size_t>(size - count, 0x40000000));
+		DWORD n;
+		if (!ReadFile(handle, static_cast<char*>(buffer) + count, step, &n, &ov) || n == 0)
+			break;
+		count += n;
+	}
+	if (saved)
+		SetFilePointerEx(handle, position, nullptr, FILE_BEGIN);
+	return count;
+}
+size_t BinaryFile::write_at(uint64_t offset, const void *buffer, size_t size) {
+	assert(!bad());
+	HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(_file.get())));
+	LARGE_INTEGER position;
+	bool saved = save_position(handle, position);
+	size_t count = 0;
+	while (count < size) {
+		OVERLAPPED ov = {};
+		ov.Offset = static_cast<DWORD>(offset + count);
+		ov.OffsetHigh = static_cast<DWORD>((offset + count) >> 32);
+		DWORD step = static_cast<DWORD>(std::min<size_t>(size - count, 0x40000000));
+		DWORD n;
+		if (!WriteFile(handle, static_cast<const char*>(buffer) + count, step, &n, &ov) || n == 0)
+			break;
+		count += n;
+	}
+	if (saved)
+		SetFilePointerEx(handle, position, nullptr, FILE_BEGIN);
+	return count;
+}
+#else
+size_t BinaryFile::read_at(uint64_t offset, void *buffer, size_t size) const {
+	assert(!bad());
+	int fd = fileno(_file.get());
+	size_t count = 0;
+	while (count < size) {
+		ssize_t n = ::pread(fd, static_cast<char*>(buffer) + count, size - count, static_cast<off_t>(offset + count));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		count += static_cast<size_t>(n);
+	}
+	return count;
+}
+size_t BinaryFile::write_at(uint64_t offset, const void *buffer, size_t size) {
+	assert(!bad());
+	int fd = fileno(_file.get());
+	size_t count = 0;
+	while (count < size) {
+		ssize_t n = ::pwrite(fd, static_cast<const char*>(buffer) + count, size - count, static_cast<off_t>(offset + count));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		count += static_cast<size_t>(n);
+	}
+	return count;
+}
+#endif
 PRILIB_END
@@ -0,0 +1,193 @@
+#include "lineindex.h"
+#include "mappedfile.h"
+#include "varint.h"
+#include "file.h"
+#include <algorithm>
+#include <thread>
+#include <functional>
+#include <cstring>
+
+#if (PRILIB_ARCH == PRILIB_ARCH_x64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#	include <emmintrin.h>
+#	define PRILIB_LINEINDEX_SSE2 1
+#endif
+
+#if (PRILIB_COMPILER == PRILIB_COMPILER_MSVC)
+#	include <intrin.h>
+#endif
+
+PRILIB_BEGIN
+//========================
+// * Scan
+//========================
+
+#if defined(PRILIB_LINEINDEX_SSE2)
+static unsigned count_bits(unsigned x)
+{
+#	if (PRILIB_COMPILER == PRILIB_COMPILER_MSVC)
+	return __popcnt(x);
+#	else
+	return static_cast<unsigned>(__builtin_popcount(x));
+#	endif
+}
+static unsigned lowest_bit(unsigned x)
+{
+#	if (PRILIB_COMPILER == PRILIB_COMPILER_MSVC)
+	unsigned long index;
+	_BitScanForward(&index, x);
+	return static_cast<unsigned>(index);
+#	else
+	return static_cast<unsigned>(__builtin_ctz(x));
+#	endif
+}
+#endif
+
+static uint64_t count_newlines(const char *begin, const char *end)
+{
+	uint64_t count = 0;
+	const char *p = begin;
+#if defined(PRILIB_LINEINDEX_SSE2)
+	const __m128i newline = _mm_set1_epi8('\n');
+	for (; end - p >= 16; p += 16) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		count += count_bits(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline))));
+	}
+#endif
+	for (; p != end; ++p)
+		count += (*p == '\n');
+	return count;
+}
+
+// Call 'yield(position)' for every '\n' in order.
+template <typename Func>
+static void find_newlines(const char *begin, const char *end, Func yield)
+{
+	const char *p = begin;
+#if defined(PRILIB_LINEINDEX_SSE2)
+	const __m128i newline = _mm_set1_epi8('\n');
+	for (; end - p >= 16; p += 16) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)));
+		while (mask != 0) {
+			yield(p + lowest_bit(mask));
+			mask &= mask - 1;
+		}
+	}
+#endif
+	while (p != end) {
+		p = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		if (p == nullptr)
+			break;
+		yield(p++);
+	}
+}
+
+//========================
+// * LineIndex
+//========================
+
+bool LineIndex::build(const std::string &filename, size_t step, size_t threads) {
+	MappedFile file(filename);
+	if (file.bad())
+		return false;
+	file.advise(MappedFile::Sequential);
+
+	_step = std::max<size_t>(step, 1);
+	_size = file.size();
+	_offsets.clear();
+	_lines = 0;
+	if (_size == 0)
+		return true;
+
+	// Pass 1 : count the newlines of each chunk.
+	threads = std::max<size_t>(1, std::min<size_t>(threads, static_cast<size_t>(_size / 0x10000) + 1));
+	std::vector<const char*> bounds;
+	for (size_t i = 0; i != threads; ++i)
+		bounds.push_back(file.begin() + _size / threads * i);
+	bounds.push_back(file.end());
+
+	std::vector<uint64_t> counts(threads);
+	auto run = [&](std::function<void(size_t)> task) {
+		std::vector<std::thread> pool;
+		for (size_t i = 1; i < threads; ++i)
+			pool.emplace_back(task, i);
+		task(0);
+		for (auto &t : pool)
+			t.join();
+	};
+	run([&](size_t i) {
+		counts[i] = count_newlines(bounds[i], bounds[i + 1]);
+	});
+
+	// Pass 2 : each chunk keeps the lines starting in it, numbered from the counts before it.
+	std::vector<uint64_t> firsts(threads + 1, 0);
+	for (size_t i = 0; i != threads; ++i)
+		firsts[i + 1] = firsts[i] + counts[i];
+	const uint64_t newlines = firsts[threads];
+	_lines = newlines + (file.end()[-1] != '\n' ? 1 : 0);
+
+	_offsets.resize(static_cast<size_t>((_lines + _step - 1) / _step));
+	_offsets[0] = 0;
+	const char *base = file.begin();
+	const uint64_t size = _size;
+	run([&](size_t i) {
+		uint64_t line = firsts[i];
+		find_newlines(bounds[i], bounds[i + 1], [&](const char *p) {
+			// The '\n' of line 'line' starts line 'line + 1'.
+			++line;
+			uint64_t offset = static_cast<uint64_t>(p - base) + 1;
+			if (line % _step == 0 && offset != size)
+				_offsets[static_cast<size_t>(line / _step)] = offset;
+		});
+	});
+	return true;
+}
+
+static const char lineindex_magic[4] = { 'P', 'L', 'I', 'X' };
+
+bool LineIndex::save(const std::string &indexname) const {
+	BinaryFile file(indexname, File::Write);
+	if (file.bad())
+		return false;
+	std::vector<byte> buffer(Varint::max_size * (_offsets.size() + 4));
+	byte *p = buffer.data();
+	p += Varint::encode(_step, p);
+	p += Varint::encode(_lines, p);
+	p += Varint::encode(_size, p);
+	p += Varint::encode(_offsets.size(), p);
+	uint64_t last = 0;
+	for (uint64_t offset : _offsets) {
+		p += Varint::encode(offset - last, p);
+		last = offset;
+	}
+	return file.write(lineindex_magic, 4) && file.write(buffer.data(), p - buffer.data()) && file.flush();
+}
+
+bool LineIndex::load(const std::string &indexname) {
+	BinaryFile file(indexname);
+	if (file.bad() || file.size() < 4)
+		return false;
+	std::vector<byte> buffer(static_cast<size_t>(file.size()));
+	if (!file.read(buffer.data(), buffer.size()) || std::memcmp(buffer.data(), lineindex_magic, 4) != 0)
+		return false;
+
+	const byte *p = buffer.data() + 4;
+	const byte *end = buffer.data() + buffer.size();
+	uint64_t head[4];
+	size_t used;
+	if (Varint::decode_n(p, end, head, 4, &used) != 4 || head[0] == 0)
+		return false;
+	p += used;
+	std::vector<uint64_t> offsets(static_cast<size_t>(std::min<uint64_t>(head[3], end - p)));
+	if (offsets.size() != head[3] || Varint::decode_n(p, end, offsets.data(), offsets.size()) != offsets.size())
+		return false;
+	for (size_t i = 1; i < offsets.size(); ++i)
+		offsets[i] += offsets[i - 1];
+
+	_step = static_cast<size_t>(head[0]);
+	_lines = head[1];
+	_size = head[2];
+	_offsets.swap(offsets);
+	return true;
+}
+PRILIB_END
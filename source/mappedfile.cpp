@@ -0,0 +1,144 @@
+#include "mappedfile.h"
+#include <limits>
+
+#if (PRILIB_OS == PRILIB_OS_WINDOWS)
+#	include <Windows.h>
+#else
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
+PRILIB_BEGIN
+//========================
+// * Mapping
+//========================
+
+class MappedFile::Mapping
+{
+public:
+	const char *data = "";
+	SizeType size = 0;
+
+#if (PRILIB_OS == PRILIB_OS_WINDOWS)
+	HANDLE mapping = nullptr;
+
+	~Mapping() {
+		if (mapping) {
+			UnmapViewOfFile(data);
+			CloseHandle(mapping);
+		}
+	}
+#else
+	~Mapping() {
+		if (size != 0)
+			munmap(const_cast<char*>(data), static_cast<size_t>(size));
+	}
+#endif
+};
+
+//========================
+// * MappedFile
+//========================
+
+const char* MappedFile::data() const {
+	assert(!bad());
+	return _map->data;
+}
+
+MappedFile::SizeType MappedFile::size() const {
+	return bad() ? 0 : _map->size;
+}
+
+#if (PRILIB_OS == PRILIB_OS_WINDOWS)
+void MappedFile::_priOpen(const std::string &filename, int flags) {
+	_map = nullptr;
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	LARGE_INTEGER size;
+	auto map = std::make_shared<Mapping>();
+	if (GetFileSizeEx(file, &size) && size.QuadPart != 0) {
+		map->mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (map->mapping) {
+			map->data = static_cast<const char*>(MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0));
+			if (map->data == nullptr) {
+				CloseHandle(map->mapping);
+				map = nullptr;
+			}
+			else {
+				map->size = static_cast<SizeType>(size.QuadPart);
+			}
+		}
+		else {
+			map = nullptr;
+		}
+	}
+	CloseHandle(file);
+	_map = map;
+}
+
+bool MappedFile::advise(Advice advice, SizeType offset, SizeType length) const {
+	return false;
+}
+#else
+static int get_advice(MappedFile::Advice advice) {
+	switch (advice) {
+	case MappedFile::Normal: return MADV_NORMAL;
+	case MappedFile::Sequential: return MADV_SEQUENTIAL;
+	case MappedFile::Random: return MADV_RANDOM;
+	case MappedFile::WillNeed: return MADV_WILLNEED;
+	case MappedFile::DontNeed: return MADV_DONTNEED;
+#if defined(MADV_HUGEPAGE)
+	case MappedFile::HugePage: return MADV_HUGEPAGE;
+#endif
+	default: return -1;
+	}
+}
+
+void MappedFile::_priOpen(const std::string &filename, int flags) {
+	_map = nullptr;
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd == -1)
+		return;
+	struct stat st;
+	auto map = std::make_shared<Mapping>();
+	if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) > std::numeric_limits<size_t>::max()) {
+		map = nullptr;
+	}
+	else if (st.st_size != 0) {
+		int mflags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+		if (flags & Populate)
+			mflags |= MAP_POPULATE;
+#endif
+		void *data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, mflags, fd, 0);
+		if (data == MAP_FAILED) {
+			map = nullptr;
+		}
+		else {
+			map->data = static_cast<const char*>(data);
+			map->size = static_cast<SizeType>(st.st_size);
+		}
+	}
+	::close(fd);
+	_map = map;
+	if (_map && (flags & HugePages))
+		advise(HugePage);
+}
+
+bool MappedFile::advise(Advice advice, SizeType offset, SizeType length) const {
+	int adv = get_advice(advice);
+	if (bad() || adv == -1)
+		return false;
+	if (length == 0)
+		return true;
+	assert(offset + length <= size());
+	// The address must be page aligned.
+	const SizeType page = static_cast<SizeType>(sysconf(_SC_PAGESIZE));
+	SizeType begin = offset / page * page;
+	return madvise(const_cast<char*>(data()) + begin, static_cast<size_t>(offset + length - begin), adv) == 0;
+}
+#endif
+PRILIB_END
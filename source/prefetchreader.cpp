@@ -0,0 +1,132 @@
+#include "prefetchreader.h"
+#include <algorithm>
+#include <cstring>
+
+PRILIB_BEGIN
+PrefetchReader::PrefetchReader(const File &file, size_t capacity, size_t depth)
+	: _file(file), _capacity(std::max<size_t>(capacity, 1)) {
+	for (size_t i = 0; i != depth + 1; ++i) {
+		_buffers.push_back(Buffer { std::unique_ptr<char[]>(new char[_capacity]), 0 });
+		_free.push_back(i);
+	}
+	if (_file.bad())
+		_end = true;
+	else
+		_thread = std::thread(&PrefetchReader::_run, this);
+}
+
+PrefetchReader::~PrefetchReader() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_cond.notify_all();
+	if (_thread.joinable())
+		_thread.join();
+}
+
+StringViewRange PrefetchReader::next() {
+	if (!_hold || _pos == _buffers[_current].size) {
+		if (!_advance())
+			return StringViewRange("", 0);
+	}
+	auto &buffer = _buffers[_current];
+	StringViewRange result(buffer.data.get() + _pos, buffer.size - _pos);
+	_pos = buffer.size;
+	return result;
+}
+
+size_t PrefetchReader::read(void *data, size_t size) {
+	size_t count = 0;
+	while (count != size) {
+		if (!_hold || _pos == _buffers[_current].size) {
+			if (!_advance())
+				break;
+		}
+		auto &buffer = _buffers[_current];
+		size_t step = std::min(size - count, buffer.size - _pos);
+		std::memcpy(static_cast<char*>(data) + count, buffer.data.get() + _pos, step);
+		_pos += step;
+		count += step;
+	}
+	return count;
+}
+
+bool PrefetchReader::getline(std::string &line) {
+	line.clear();
+	bool read = false;
+	while (true) {
+		if (!_hold || _pos == _buffers[_current].size) {
+			if (!_advance())
+				break;
+		}
+		auto &buffer = _buffers[_current];
+		const char *p = buffer.data.get() + _pos;
+		size_t n = buffer.size - _pos;
+		read = true;
+		auto q = static_cast<const char*>(std::memchr(p, '\n', n));
+		if (q != nullptr) {
+			line.append(p, q);
+			_pos += q - p + 1;
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+			return true;
+		}
+		line.append(p, n);
+		_pos = buffer.size;
+	}
+	return read;
+}
+
+bool PrefetchReader::eof() {
+	if (_hold && _pos != _buffers[_current].size)
+		return false;
+	return !_advance();
+}
+
+void PrefetchReader::_run() {
+	while (true) {
+		size_t id;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_cond.wait(lock, [this] { return _stop || !_free.empty(); });
+			if (_stop)
+				return;
+			id = _free.front();
+			_free.pop_front();
+		}
+		auto &buffer = _buffers[id];
+		buffer.size = std::fread(buffer.data.get(), 1, _capacity, _file.c_ptr());
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_ready.push_back(id);
+		}
+		_cond.notify_all();
+		// An empty chunk marks the end of file (or an error).
+		if (buffer.size == 0)
+			return;
+	}
+}
+
+// Give the current chunk back to the thread and take the next one.
+bool PrefetchReader::_advance() {
+	if (_end)
+		return false;
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (_hold) {
+		_free.push_back(_current);
+		_hold = false;
+		_cond.notify_all();
+	}
+	_cond.wait(lock, [this] { return !_ready.empty(); });
+	_current = _ready.front();
+	_ready.pop_front();
+	_hold = true;
+	_pos = 0;
+	if (_buffers[_current].size == 0) {
+		_end = true;
+		return false;
+	}
+	return true;
+}
+PRILIB_END
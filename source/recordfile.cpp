@@ -0,0 +1,84 @@
+#include "recordfile.h"
+#include "varint.h"
+#include <cstdio>
+
+PRILIB_BEGIN
+//========================
+// * CRC-32
+//========================
+
+// Slicing-by-4 tables of the reflected polynomial 0xEDB88320.
+struct CRC32Table
+{
+	uint32_t data[4][0x100];
+
+	CRC32Table() {
+		for (uint32_t i = 0; i != 0x100; ++i) {
+			uint32_t c = i;
+			for (int k = 0; k != 8; ++k)
+				c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+			data[0][i] = c;
+		}
+		for (uint32_t i = 0; i != 0x100; ++i) {
+			for (int t = 1; t != 4; ++t)
+				data[t][i] = (data[t - 1][i] >> 8) ^ data[0][data[t - 1][i] & 0xff];
+		}
+	}
+};
+
+uint32_t crc32(const void *data, size_t size, uint32_t crc)
+{
+	static const CRC32Table table;
+	auto &t = table.data;
+	const byte *p = static_cast<const byte*>(data);
+	crc = ~crc;
+	for (; size >= 4; size -= 4, p += 4) {
+		crc ^= static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+		crc = t[3][crc & 0xff] ^ t[2][(crc >> 8) & 0xff] ^ t[1][(crc >> 16) & 0xff] ^ t[0][crc >> 24];
+	}
+	for (; size != 0; --size, ++p)
+		crc = t[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+//========================
+// * RecordWriter
+//========================
+
+bool RecordWriter::write(const void *data, size_t size) {
+	byte head[Varint::max_size];
+	size_t n = Varint::encode(size, head);
+	uint32_t crc = crc32(data, size);
+	byte tail[4] = {
+		static_cast<byte>(crc), static_cast<byte>(crc >> 8), static_cast<byte>(crc >> 16), static_cast<byte>(crc >> 24)
+	};
+	return _file.write(head, n) && (size == 0 || _file.write(data, 1, size)) && _file.write(tail, 4);
+}
+
+//========================
+// * RecordReader
+//========================
+
+RecordReader::Status RecordReader::read(std::string &payload) {
+	FILE *fp = _file.c_ptr();
+	byte head[Varint::max_size];
+	size_t n = 0;
+	int c;
+	while (n != Varint::max_size && (c = std::getc(fp)) != EOF) {
+		head[n++] = static_cast<byte>(c);
+		if ((c & 0x80) == 0)
+			break;
+	}
+	if (n == 0)
+		return End;
+	uint64_t size;
+	if (Varint::decode(head, head + n, size) != n || size > _maxsize)
+		return Corrupt;
+	payload.resize(static_cast<size_t>(size));
+	byte tail[4];
+	if ((size != 0 && std::fread(&payload[0], 1, payload.size(), fp) != payload.size()) || std::fread(tail, 1, 4, fp) != 4)
+		return Corrupt;
+	uint32_t crc = static_cast<uint32_t>(tail[0]) | (static_cast<uint32_t>(tail[1]) << 8) | (static_cast<uint32_t>(tail[2]) << 16) | (static_cast<uint32_t>(tail[3]) << 24);
+	return crc == crc32(payload.data(), payload.size()) ? Ok : Corrupt;
+}
+PRILIB_END
@@ -0,0 +1,68 @@
+#include "stringbuilder.h"
+#include "prints.h"
+#include <algorithm>
+#include <cstdio>
+
+PRILIB_BEGIN
+StringBuilder& StringBuilder::append(char c, size_t count) {
+	std::memset(_room(count), c, count);
+	_size += count;
+	return *this;
+}
+
+StringBuilder& StringBuilder::append(const void *p) {
+	char buffer[sizeof(void*) * 2 + 3];
+	int size = std::snprintf(buffer, sizeof(buffer), "0x%p", p);
+	return append(buffer, std::min(static_cast<size_t>(size), sizeof(buffer) - 1));
+}
+
+StringBuilder& StringBuilder::append_hex(const void *src, size_t size, char separator) {
+	size_t length = Convert::hex_size(size, separator);
+	char *p = _room(length);
+	if (size != 0)
+		_size = Convert::hex_encode(src, size, p, separator) - _data;
+	return *this;
+}
+
+bool StringBuilder::flush() {
+	if (_sink.bad())
+		return true;
+	if (_size != 0 && std::fwrite(_data, sizeof(char), _size, _sink) != _size)
+		_good = false;
+	_size = 0;
+	return _good;
+}
+
+void StringBuilder::_grow(size_t size) {
+	if (!_sink.bad()) {
+		flush();
+		if (size <= _capacity)
+			return;
+	}
+	size_t capacity = std::max(_size + size, _capacity * 2);
+	std::unique_ptr<char[]> heap(new char[capacity]);
+	std::memcpy(heap.get(), _data, _size);
+	_heap = std::move(heap);
+	_data = _heap.get();
+	_capacity = capacity;
+}
+
+StringBuilder& StringBuilder::_append(const char *data, size_t size) {
+	// Too large for the buffer of a sink : straight to the file.
+	if (!_sink.bad()) {
+		flush();
+		if (size > _capacity) {
+			if (std::fwrite(data, sizeof(char), size, _sink) != size)
+				_good = false;
+			return *this;
+		}
+	}
+	std::memcpy(_room(size), data, size);
+	_size += size;
+	return *this;
+}
+
+void Output::print(const StringBuilder &builder) {
+	std::fwrite(builder.data(), sizeof(char), builder.size(), stdout);
+}
+PRILIB_END
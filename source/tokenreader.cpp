@@ -0,0 +1,123 @@
+#include "tokenreader.h"
+#include <cstdlib>
+#include <cstring>
+
+PRILIB_BEGIN
+//========================
+// * Token
+//========================
+
+static bool is_space(char c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+bool TokenReader::_token(const char *&begin, const char *&end) {
+	// Skip whitespace.
+	for (;;) {
+		const char *p = _reader.window();
+		const char *last = p + _reader.available();
+		while (p != last && is_space(*p))
+			++p;
+		_reader.consume(p - _reader.window());
+		if (p != last)
+			break;
+		if (!_reader.fill())
+			return false;
+	}
+	// Refill until the token ends before the end of the window, or the file ends.
+	size_t scanned = 0;
+	for (;;) {
+		const char *p = _reader.window() + scanned;
+		const char *last = _reader.window() + _reader.available();
+		while (p != last && !is_space(*p))
+			++p;
+		scanned = p - _reader.window();
+		if (p != last || !_reader.fill())
+			break;
+	}
+	begin = _reader.window();
+	end = begin + scanned;
+	return true;
+}
+
+bool TokenReader::read(char &value) {
+	const char *begin, *end;
+	if (!_token(begin, end))
+		return false;
+	value = *begin;
+	_reader.consume(1);
+	return true;
+}
+
+bool TokenReader::read(std::string &value) {
+	const char *begin, *end;
+	if (!_token(begin, end))
+		return false;
+	value.assign(begin, end);
+	_reader.consume(end - begin);
+	return true;
+}
+
+//========================
+// * Parse
+//========================
+
+// Through strtold on a terminated copy of the token.
+template <typename T, typename Func>
+static bool parse_float(const char *begin, const char *end, T &value, Func convert)
+{
+	char buffer[64];
+	std::string large;
+	size_t size = end - begin;
+	char *text = buffer;
+	if (size >= sizeof(buffer)) {
+		large.assign(begin, end);
+		text = &large[0];
+	}
+	else {
+		std::memcpy(buffer, begin, size);
+		buffer[size] = '\0';
+	}
+	char *last;
+	T result = convert(text, &last);
+	if (last != text + size)
+		return false;
+	value = result;
+	return true;
+}
+
+bool TokenReader::_parse(const char *begin, const char *end, short &value) {
+	return Convert::from_chars(begin, end, value);
+}
+bool TokenReader::_parse(const char *begin, const char *end, int &value) {
+	return Convert::from_chars(begin, end, value);
+}
+bool TokenReader::_parse(const char *begin, const char *end, long &value) {
+	return Convert::from_chars(begin, end, value);
+}
+bool TokenReader::_parse(const char *begin, const char *end, long long &value) {
+	return Convert::from_chars(begin, end, value);
+}
+bool TokenReader::_parse(const char *begin, const char *end, unsigned short &value) {
+	return Convert::from_chars(begin, end, value);
+}
+bool TokenReader::_parse(const char *begin, const char *end, unsigned &value) {
+	return Convert::from_chars(begin, end, value);
+}
+bool TokenReader::_parse(const char *begin, const char *end, unsigned long &value) {
+	return Convert::from_chars(begin, end, value);
+}
+bool TokenReader::_parse(const char *begin, const char *end, unsigned long long &value) {
+	return Convert::from_chars(begin, end, value);
+}
+bool TokenReader::_parse(const char *begin, const char *end, float &value) {
+	return Convert::from_chars(begin, end, value);
+}
+bool TokenReader::_parse(const char *begin, const char *end, double &value) {
+	return Convert::from_chars(begin, end, value);
+}
+bool TokenReader::_parse(const char *begin, const char *end, long double &value) {
+	return parse_float(begin, end, value, [](const char *s, char **last) { return std::strtold(s, last); });
+}
+PRILIB_END
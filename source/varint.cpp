@@ -0,0 +1,103 @@
+#include "varint.h"
+#include <cstring>
+
+#if (PRILIB_ARCH == PRILIB_ARCH_x64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#	include <emmintrin.h>
+#	define PRILIB_VARINT_SSE2 1
+#endif
+
+#if (PRILIB_COMPILER == PRILIB_COMPILER_MSVC)
+#	include <intrin.h>
+#endif
+
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || (PRILIB_ARCH == PRILIB_ARCH_x64) || (PRILIB_ARCH == PRILIB_ARCH_x86)
+#	define PRILIB_VARINT_WORD 1
+#endif
+
+PRILIB_BEGIN
+namespace Varint
+{
+	size_t encode_n(const uint64_t *src, size_t count, byte *dst)
+	{
+		byte *p = dst;
+		for (size_t i = 0; i != count; ++i)
+			p += encode(src[i], p);
+		return p - dst;
+	}
+
+#if defined(PRILIB_VARINT_WORD)
+	static unsigned count_trailing_zeros(uint64_t x)
+	{
+#	if (PRILIB_COMPILER == PRILIB_COMPILER_MSVC)
+		unsigned long index;
+		_BitScanForward64(&index, x);
+		return static_cast<unsigned>(index);
+#	else
+		return static_cast<unsigned>(__builtin_ctzll(x));
+#	endif
+	}
+
+	// Decode a value of at most 8 bytes from a little endian word.
+	// Return the count of bytes, 0 if the value is longer.
+	static size_t decode_word(const byte *src, uint64_t &value)
+	{
+		uint64_t x;
+		std::memcpy(&x, src, sizeof(x));
+		uint64_t stop = ~x & 0x8080808080808080ull;
+		if (stop == 0)
+			return 0;
+		size_t length = count_trailing_zeros(stop) / 8 + 1;
+		if (length != 8)
+			x &= (1ull << (8 * length)) - 1;
+		// Pack the 7-bit groups.
+		value = (x & 0x7full)
+			| ((x >> 1) & (0x7full << 7))
+			| ((x >> 2) & (0x7full << 14))
+			| ((x >> 3) & (0x7full << 21))
+			| ((x >> 4) & (0x7full << 28))
+			| ((x >> 5) & (0x7full << 35))
+			| ((x >> 6) & (0x7full << 42))
+			| ((x >> 7) & (0x7full << 49));
+		return length;
+	}
+#endif
+
+	size_t decode_n(const byte *src, const byte *end, uint64_t *dst, size_t count, size_t *used)
+	{
+		const byte *p = src;
+		size_t i = 0;
+		while (i != count) {
+#if defined(PRILIB_VARINT_SSE2)
+			if (end - p >= 16 && count - i >= 16) {
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+				if (_mm_movemask_epi8(v) == 0) {
+					for (size_t k = 0; k != 16; ++k)
+						dst[i + k] = p[k];
+					p += 16;
+					i += 16;
+					continue;
+				}
+			}
+#endif
+#if defined(PRILIB_VARINT_WORD)
+			if (end - p >= 8) {
+				size_t n = decode_word(p, dst[i]);
+				if (n != 0) {
+					p += n;
+					++i;
+					continue;
+				}
+			}
+#endif
+			size_t n = decode(p, end, dst[i]);
+			if (n == 0)
+				break;
+			p += n;
+			++i;
+		}
+		if (used)
+			*used = p - src;
+		return i;
+	}
+}
+PRILIB_END